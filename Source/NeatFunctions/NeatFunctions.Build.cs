@@ -25,6 +25,8 @@ public class NeatFunctions : ModuleRules
 			"KismetCompiler",
 			"Projects",
 			"GraphEditor",
+			"DeveloperSettings",
+			"AssetRegistry",
 		});
 	}
 }
\ No newline at end of file
@@ -0,0 +1,205 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+#include "K2Node_NeatBatchFunction.h"
+#include "NeatFunctionIndex.h"
+#include "NeatFunctionNodeSpawner.h"
+#include "NeatFunctionsStatics.h"
+#include "NeatFunctionsStyle.h"
+
+#include "BlueprintActionDatabaseRegistrar.h"
+#include "K2Node_TemporaryVariable.h"
+#include "KismetCompiler.h"
+#include "Kismet2/BlueprintEditorUtils.h"
+
+void UK2Node_NeatBatchFunction::GetMenuActions(FBlueprintActionDatabaseRegistrar& ActionRegistrar) const
+{
+	UClass* NodeClass = GetClass();
+	for (const UFunction* Fn : TObjectRange<UFunction>())
+	{
+		const bool bNeatBatchFunction = Fn ? Fn->HasMetaData(BatchFunctionMetadataName) : false;
+		if (!bNeatBatchFunction || !ActionRegistrar.IsOpenForRegistration(Fn->GetOwnerClass()))
+			continue;
+
+		UNeatFunctionNodeSpawner* NodeSpawner = UNeatFunctionNodeSpawner::Create(NodeClass, Fn, [](const UFunction&)
+		{
+			return FSlateIcon(FNeatFunctionsStyle::Get().GetStyleSetName(), "NeatFunctions.FunctionIcon");
+		});
+
+		NodeSpawner->CustomizeNodeDelegate.BindLambda([Fn](UEdGraphNode* Node, bool)
+		{
+			ThisClass* ThisNode = Cast<ThisClass>(Node);
+			ThisNode->SetFromFunction(Fn);
+		});
+
+		ActionRegistrar.AddBlueprintAction(Fn->GetOwnerClass(), NodeSpawner);
+	}
+}
+
+void UK2Node_NeatBatchFunction::AllocateDefaultPins()
+{
+	// Batched calls always need an execution pin to run the loop from, even when the function itself is pure.
+	bIsPureFunc = false;
+
+	Super::AllocateDefaultPins();
+
+	for (UEdGraphPin* Pin : Pins)
+	{
+		if (!IsBatchedPin(Pin))
+			continue;
+
+		Pin->PinType.ContainerType = EPinContainerType::Array;
+		Pin->PinType.bIsReference = false;
+		Pin->DefaultValue.Reset();
+		Pin->AutogeneratedDefaultValue.Reset();
+		Pin->DefaultObject = nullptr;
+	}
+
+	FNeatFunctionIndex::Get().Register(this, GetTargetFunction());
+}
+
+void UK2Node_NeatBatchFunction::ExpandNode(FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph)
+{
+	Super::ExpandNode(CompilerContext, SourceGraph);
+
+	const UFunction* Function = GetTargetFunction();
+	if (!Function || !GetBatchError(*Function).IsEmpty())
+	{
+		BreakAllNodeLinks();
+		return;
+	}
+
+	const UEdGraphSchema_K2* Schema = CompilerContext.GetSchema();
+	const auto SpawnStaticsCall = [&](FName FunctionName)
+	{
+		UK2Node_CallFunction* CallFunc = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(this, SourceGraph);
+		CallFunc->SetFromFunction(UNeatFunctionsStatics::StaticClass()->FindFunctionByName(FunctionName));
+		CallFunc->AllocateDefaultPins();
+		return CallFunc;
+	};
+
+	UK2Node_CallFunction* BeginFunc = SpawnStaticsCall(GET_MEMBER_NAME_CHECKED(UNeatFunctionsStatics, BeginNeatBatch));
+	BeginFunc->FindPinChecked(TEXT("Class"))->DefaultObject = Function->GetOwnerClass();
+	BeginFunc->FindPinChecked(TEXT("FunctionName"))->DefaultValue = Function->GetName();
+	Schema->TrySetDefaultValue(*BeginFunc->FindPinChecked(TEXT("bParallel")), FBlueprintEditorUtils::HasFunctionBlueprintThreadSafeMetaData(Function) ? TEXT("true") : TEXT("false"));
+
+	CompilerContext.MovePinLinksToIntermediate(*GetExecPin(), *BeginFunc->GetExecPin());
+	UEdGraphPin* LastThen = BeginFunc->GetThenPin();
+	UEdGraphPin* BatchPin = BeginFunc->GetReturnValuePin();
+
+	for (UEdGraphPin* Pin : Pins)
+	{
+		if (!IsBatchedPin(Pin))
+			continue;
+
+		if (Pin->Direction == EGPD_Input)
+		{
+			UK2Node_CallFunction* AddInputFunc = SpawnStaticsCall(GET_MEMBER_NAME_CHECKED(UNeatFunctionsStatics, AddNeatBatchInput));
+			AddInputFunc->FindPinChecked(TEXT("Batch"))->MakeLinkTo(BatchPin);
+			AddInputFunc->FindPinChecked(TEXT("ParameterName"))->DefaultValue = Pin->PinName.ToString();
+
+			UEdGraphPin* ValuesPin = AddInputFunc->FindPinChecked(TEXT("Values"));
+			ValuesPin->PinType = Pin->PinType;
+			CompilerContext.MovePinLinksToIntermediate(*Pin, *ValuesPin);
+
+			LastThen->MakeLinkTo(AddInputFunc->GetExecPin());
+			LastThen = AddInputFunc->GetThenPin();
+		}
+		else
+		{
+			// The results are written straight into a temporary array, which the output pin then reads.
+			UK2Node_TemporaryVariable* OutputVar = CompilerContext.SpawnIntermediateNode<UK2Node_TemporaryVariable>(this, SourceGraph);
+			OutputVar->VariableType = Pin->PinType;
+			OutputVar->AllocateDefaultPins();
+
+			UK2Node_CallFunction* AddOutputFunc = SpawnStaticsCall(GET_MEMBER_NAME_CHECKED(UNeatFunctionsStatics, AddNeatBatchOutput));
+			AddOutputFunc->FindPinChecked(TEXT("Batch"))->MakeLinkTo(BatchPin);
+			AddOutputFunc->FindPinChecked(TEXT("ParameterName"))->DefaultValue = Pin->PinName.ToString();
+
+			UEdGraphPin* ValuesPin = AddOutputFunc->FindPinChecked(TEXT("Values"));
+			ValuesPin->PinType = Pin->PinType;
+			ValuesPin->PinType.bIsReference = true;
+			OutputVar->GetVariablePin()->MakeLinkTo(ValuesPin);
+			CompilerContext.MovePinLinksToIntermediate(*Pin, *OutputVar->GetVariablePin());
+
+			LastThen->MakeLinkTo(AddOutputFunc->GetExecPin());
+			LastThen = AddOutputFunc->GetThenPin();
+		}
+	}
+
+	UK2Node_CallFunction* ExecuteFunc = SpawnStaticsCall(GET_MEMBER_NAME_CHECKED(UNeatFunctionsStatics, ExecuteNeatBatch));
+	ExecuteFunc->FindPinChecked(TEXT("Batch"))->MakeLinkTo(BatchPin);
+	LastThen->MakeLinkTo(ExecuteFunc->GetExecPin());
+	CompilerContext.MovePinLinksToIntermediate(*GetThenPin(), *ExecuteFunc->GetThenPin());
+
+	BreakAllNodeLinks();
+}
+
+void UK2Node_NeatBatchFunction::ValidateNodeDuringCompilation(FCompilerResultsLog& MessageLog) const
+{
+	Super::ValidateNodeDuringCompilation(MessageLog);
+
+	if (const UFunction* Function = GetTargetFunction())
+	{
+		const FString Error = GetBatchError(*Function);
+		if (!Error.IsEmpty())
+		{
+			MessageLog.Error(*FString::Printf(TEXT("@@ can't batch %s. %s"), *Function->GetName(), *Error), this);
+		}
+	}
+
+	// Array pins have no default value to pass to every call, so an unconnected input would silently process no elements at all.
+	for (const UEdGraphPin* Pin : Pins)
+	{
+		if (IsBatchedPin(Pin) && Pin->Direction == EGPD_Input && Pin->LinkedTo.Num() == 0)
+		{
+			MessageLog.Error(TEXT("@@ must be connected. Connect an array with a single element to pass the same value to every call."), Pin);
+		}
+	}
+}
+
+FText UK2Node_NeatBatchFunction::GetNodeTitle(ENodeTitleType::Type TitleType) const
+{
+	return FText::Format(INVTEXT("{0} (Batch)"), Super::GetNodeTitle(TitleType));
+}
+
+FSlateIcon UK2Node_NeatBatchFunction::GetIconAndTint(FLinearColor& OutColor) const
+{
+	return FSlateIcon(FNeatFunctionsStyle::Get().GetStyleSetName(), "NeatFunctions.FunctionIcon");
+}
+
+bool UK2Node_NeatBatchFunction::IsBatchedPin(const UEdGraphPin* Pin) const
+{
+	if (!Pin || Pin->bHidden || Pin->PinType.PinCategory == UEdGraphSchema_K2::PC_Exec || Pin->PinName == UEdGraphSchema_K2::PN_Self)
+		return false;
+
+	const UFunction* Function = GetTargetFunction();
+	return Function && Function->FindPropertyByName(Pin->PinName) != nullptr;
+}
+
+FString UK2Node_NeatBatchFunction::GetBatchError(const UFunction& Function)
+{
+	if (!Function.HasAnyFunctionFlags(FUNC_Static))
+		return TEXT("Only static functions can be batched.");
+
+	if (Function.HasMetaData(FBlueprintMetadata::MD_WorldContext) || Function.HasMetaData(FBlueprintMetadata::MD_Latent))
+		return TEXT("Functions that need a world context, or are latent, can't be batched.");
+
+	int32 NumInputs = 0;
+	for (TFieldIterator<FProperty> PropIt(&Function); PropIt && PropIt->HasAnyPropertyFlags(CPF_Parm); ++PropIt)
+	{
+		const FProperty* Param = *PropIt;
+		if (Param->IsA<FArrayProperty>() || Param->IsA<FSetProperty>() || Param->IsA<FMapProperty>() || Param->IsA<FDelegateProperty>() || Param->IsA<FMulticastDelegateProperty>())
+			return FString::Printf(TEXT("Parameter %s is a container or a delegate."), *Param->GetName());
+
+		// Const references are inputs like any other, but a mutable reference would have to write back into the input array.
+		const bool bIsInput = !Param->HasAnyPropertyFlags(CPF_OutParm) || Param->HasAnyPropertyFlags(CPF_ReferenceParm);
+		if (bIsInput && Param->HasAnyPropertyFlags(CPF_ReferenceParm) && !Param->HasAnyPropertyFlags(CPF_ConstParm))
+			return FString::Printf(TEXT("Parameter %s is passed by non-const reference."), *Param->GetName());
+
+		NumInputs += bIsInput ? 1 : 0;
+	}
+
+	if (NumInputs == 0)
+		return TEXT("The function has no inputs to batch over.");
+
+	return FString();
+}
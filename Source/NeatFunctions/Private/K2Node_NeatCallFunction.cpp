@@ -1,42 +1,62 @@
 ﻿// Copyright Viktor Pramberg. All Rights Reserved.
 #include "K2Node_NeatCallFunction.h"
+#include "NeatFunctionIndex.h"
+#include "NeatFunctionNodeSpawner.h"
+#include "NeatFunctionsLint.h"
+#include "NeatFunctionsProfiling.h"
+#include "NeatFunctionsStatics.h"
 #include "NeatFunctionsStyle.h"
 
 #include "BlueprintActionDatabaseRegistrar.h"
-#include "BlueprintFunctionNodeSpawner.h"
 #include "KismetCompiler.h"
 
+#include "K2Node_AssignmentStatement.h"
 #include "K2Node_CustomEvent.h"
+#include "K2Node_ExecutionSequence.h"
+#include "K2Node_IfThenElse.h"
+#include "K2Node_Self.h"
+#include "K2Node_TemporaryVariable.h"
 #include "SGraphPin.h"
 #include "KismetNodes/SGraphNodeK2Default.h"
 #include "Widgets/Colors/SSimpleGradient.h"
 
 const FName UK2Node_NeatCallFunction::DelegateFunctionMetadataName("NeatDelegateFunction");
 
+namespace
+{
+	TAutoConsoleVariable<bool> CVarReportPersistentFrameUsage(
+		TEXT("NeatFunctions.ReportPersistentFrameUsage"),
+		false,
+		TEXT("When enabled, each Neat delegate function node reports how many bytes its delegate parameters add to the persistent ubergraph frame of every instance when compiled. ")
+		TEXT("Delegates with nothing connected add nothing, since they are left unbound."));
+}
+
 void UK2Node_NeatCallFunction::GetMenuActions(FBlueprintActionDatabaseRegistrar& ActionRegistrar) const
 {
 	UClass* NodeClass = GetClass();
-	if (ActionRegistrar.IsOpenForRegistration(NodeClass))
+	for (const UFunction* Fn : TObjectRange<UFunction>())
 	{
-		for (const UFunction* Fn : TObjectRange<UFunction>())
+		const bool bNeatDelegateFunction = Fn ? Fn->HasMetaData(DelegateFunctionMetadataName) : false;
+		if (!bNeatDelegateFunction)
+			continue;
+
+		// Actions are keyed on the class owning the function, so only the functions of a class that changed are registered again.
+		// The action menu also uses that to filter out member functions of classes that aren't relevant to the current Blueprint.
+		if (!ActionRegistrar.IsOpenForRegistration(Fn->GetOwnerClass()))
+			continue;
+
+		UNeatFunctionNodeSpawner* NodeSpawner = UNeatFunctionNodeSpawner::Create(NodeClass, Fn, [](const UFunction&)
 		{
-			const bool bNeatDelegateFunction = Fn ? Fn->HasMetaData(DelegateFunctionMetadataName) : false;
-			if (!bNeatDelegateFunction)
-				continue;
-		
-			UBlueprintFunctionNodeSpawner* NodeSpawner = UBlueprintFunctionNodeSpawner::Create(NodeClass, Fn);
-			check(NodeSpawner != nullptr);
-			
-			NodeSpawner->DefaultMenuSignature.Icon = FSlateIcon(FNeatFunctionsStyle::Get().GetStyleSetName(), "NeatFunctions.FunctionIcon");
-			NodeSpawner->DefaultMenuSignature.IconTint = FLinearColor::White;
-			NodeSpawner->CustomizeNodeDelegate.BindLambda([Fn](UEdGraphNode* Node, bool)
-			{
-				ThisClass* ThisNode = Cast<ThisClass>(Node);
-				ThisNode->SetFromFunction(Fn);
-			});
-			
-			ActionRegistrar.AddBlueprintAction(NodeClass, NodeSpawner);
-		}
+			return FSlateIcon(FNeatFunctionsStyle::Get().GetStyleSetName(), "NeatFunctions.FunctionIcon");
+		});
+
+		NodeSpawner->CustomizeNodeDelegate.BindLambda([Fn](UEdGraphNode* Node, bool)
+		{
+			ThisClass* ThisNode = Cast<ThisClass>(Node);
+			ThisNode->SetFromFunction(Fn);
+		});
+
+		ActionRegistrar.AddBlueprintAction(Fn->GetOwnerClass(), NodeSpawner);
 	}
 }
 
@@ -44,6 +64,9 @@ void UK2Node_NeatCallFunction::AllocateDefaultPins()
 {
 	Super::AllocateDefaultPins();
 
+	// Nodes in function graphs are regular call nodes, but they still need to be refreshed when the function changes.
+	FNeatFunctionIndex::Get().Register(this, GetTargetFunction());
+
 	// This should always be called. Otherwise it might have an invalid cached value (if copying from event graph to function graph, for example)
 	bIsNeatFunction = GetDefault<UK2Node_CustomEvent>()->IsCompatibleWithGraph(GetGraph());
 	if (!bIsNeatFunction)
@@ -79,6 +102,14 @@ void UK2Node_NeatCallFunction::AllocateDefaultPins()
 				GeneratePinTooltipFromFunction(*Pin, Prop.SignatureFunction);
 			}
 		}
+
+		if (IsDelegateCoalesced(Prop))
+		{
+			UEdGraphPin* CountPin = CreatePin(EGPD_Output, UEdGraphSchema_K2::PC_Int, GetCoalescedCountPinName(Prop));
+			CountPin->PinFriendlyName = INVTEXT("Fire Count");
+			CountPin->PinToolTip = TEXT("Number of times the delegate fired during the frame. Only the parameters of the latest fire are available.");
+			CountPin->SourceIndex = ExecPin->SourceIndex;
+		}
 	});
 }
 
@@ -123,8 +154,30 @@ void UK2Node_NeatCallFunction::ExpandNode(FKismetCompilerContext& CompilerContex
 	MovePinLinksForDirection(EGPD_Input);
 	MovePinLinksForDirection(EGPD_Output);
 
+	if (CVarReportPersistentFrameUsage.GetValueOnGameThread())
+	{
+		ReportPersistentFrameUsage(CompilerContext.MessageLog);
+	}
+
+	if (GetTargetFunction()->HasMetaData(PersistentMetadataName))
+	{
+		ExpandPersistentGate(CompilerContext, SourceGraph, *CallFunc);
+	}
+
+	if (NeatFunctionsProfiling::ShouldInstrumentNodes())
+	{
+		NeatFunctionsProfiling::InsertBeginSample(CompilerContext, SourceGraph, this, *CallFunc->GetExecPin());
+		NeatFunctionsProfiling::AppendEndSample(CompilerContext, SourceGraph, this, *CallFunc->GetThenPin());
+	}
+
 	ForEachEligableDelegateProperty([&](const FDelegateProperty& Prop)
 	{
+		// The outputs of a generated event are stored in the persistent frame of every instance, whether they're read or not.
+		// The event has to match the delegate signature, so the only way to keep them out of the frame is to not generate the event when nothing uses it.
+		// Recorded nodes keep their events, so every fire still shows up in the profile.
+		if (!IsDelegateUsed(Prop) && !NeatFunctionsProfiling::ShouldRecordNodes())
+			return;
+
 		const UK2Node_CustomEvent* EventNode = UK2Node_CustomEvent::CreateFromFunction(FVector2D::ZeroVector, SourceGraph, FString::Printf(TEXT("%s_%s"), *Prop.GetName(), *CompilerContext.GetGuid(this)), Prop.SignatureFunction);
 
 		UEdGraphPin* DelegatePin = EventNode->FindPin(UK2Node_Event::DelegateOutputName);
@@ -133,6 +186,30 @@ void UK2Node_NeatCallFunction::ExpandNode(FKismetCompilerContext& CompilerContex
 
 		UEdGraphPin* EventThenPin = EventNode->GetThenPin();
 		UEdGraphPin* ThenPinForCurrentDelegate = FindPin(Prop.GetFName());
+
+		if (NeatFunctionsProfiling::ShouldRecordNodes())
+		{
+			// Record every fire, including the ones that are later coalesced.
+			EventThenPin = NeatFunctionsProfiling::AppendRecordDelegateFire(CompilerContext, SourceGraph, this, *EventThenPin, GetTargetFunction(), Prop.SignatureFunction->ParmsSize);
+		}
+
+		if (IsDelegateCoalesced(Prop))
+		{
+			// The event bound to the C++ delegate only stores the payload (in its outputs) and queues a dispatch.
+			// The dispatch event runs the connected logic once per frame, reading the latest payload from the first event's outputs.
+			UK2Node_CallFunction* QueueFunc = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(this, SourceGraph);
+			QueueFunc->SetFromFunction(UNeatFunctionsStatics::StaticClass()->FindFunctionByName(GET_MEMBER_NAME_CHECKED(UNeatFunctionsStatics, QueueCoalescedDispatch)));
+			QueueFunc->AllocateDefaultPins();
+			Schema->TryCreateConnection(EventThenPin, QueueFunc->GetExecPin());
+
+			const FDelegateProperty* DispatchProp = CastFieldChecked<FDelegateProperty>(QueueFunc->GetTargetFunction()->FindPropertyByName(TEXT("Dispatch")));
+			const UK2Node_CustomEvent* DispatchEventNode = UK2Node_CustomEvent::CreateFromFunction(FVector2D::ZeroVector, SourceGraph, FString::Printf(TEXT("%s_%s_Coalesced"), *Prop.GetName(), *CompilerContext.GetGuid(this)), DispatchProp->SignatureFunction);
+			Schema->TryCreateConnection(DispatchEventNode->FindPin(UK2Node_Event::DelegateOutputName), QueueFunc->FindPin(DispatchProp->GetFName(), EGPD_Input));
+
+			EventThenPin = DispatchEventNode->GetThenPin();
+			bIsValid &= CompilerContext.MovePinLinksToIntermediate(*FindPin(GetCoalescedCountPinName(Prop)), *DispatchEventNode->FindPin(TEXT("FireCount"))).CanSafeConnect();
+		}
+
 		bIsValid &= CompilerContext.MovePinLinksToIntermediate(*ThenPinForCurrentDelegate, *EventThenPin).CanSafeConnect();
 
 		for (TFieldIterator<FProperty> PropIt(Prop.SignatureFunction); PropIt && (PropIt->PropertyFlags & CPF_Parm); ++PropIt)
@@ -149,6 +226,80 @@ void UK2Node_NeatCallFunction::ExpandNode(FKismetCompilerContext& CompilerContex
 	BreakAllNodeLinks();
 }
 
+void UK2Node_NeatCallFunction::ExpandPersistentGate(FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph, UK2Node_CallFunction& CallFunc)
+{
+	const UEdGraphSchema_K2* Schema = CompilerContext.GetSchema();
+
+	// Neat delegate functions only work in event graphs, so this always ends up in the persistent ubergraph frame of the instance.
+	UK2Node_TemporaryVariable* IsBoundVar = CompilerContext.SpawnIntermediateNode<UK2Node_TemporaryVariable>(this, SourceGraph);
+	IsBoundVar->VariableType.PinCategory = UEdGraphSchema_K2::PC_Boolean;
+	IsBoundVar->bIsPersistent = true;
+	IsBoundVar->AllocateDefaultPins();
+
+	UK2Node_IfThenElse* BranchNode = CompilerContext.SpawnIntermediateNode<UK2Node_IfThenElse>(this, SourceGraph);
+	BranchNode->AllocateDefaultPins();
+	Schema->TryCreateConnection(IsBoundVar->GetVariablePin(), BranchNode->GetConditionPin());
+
+	UK2Node_AssignmentStatement* AssignNode = CompilerContext.SpawnIntermediateNode<UK2Node_AssignmentStatement>(this, SourceGraph);
+	AssignNode->AllocateDefaultPins();
+	Schema->TryCreateConnection(IsBoundVar->GetVariablePin(), AssignNode->GetVariablePin());
+	AssignNode->NotifyPinConnectionListChanged(AssignNode->GetVariablePin());
+	Schema->TrySetDefaultValue(*AssignNode->GetValuePin(), TEXT("true"));
+
+	UK2Node_CallFunction* RegisterFunc = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(this, SourceGraph);
+	RegisterFunc->SetFromFunction(UNeatFunctionsStatics::StaticClass()->FindFunctionByName(GET_MEMBER_NAME_CHECKED(UNeatFunctionsStatics, RegisterNeatPersistentBinding)));
+	RegisterFunc->AllocateDefaultPins();
+
+	// The registry calls the unbind function on the same object the delegates are bound on, once the owner is destroyed.
+	const UFunction* Function = GetTargetFunction();
+	RegisterFunc->FindPinChecked(TEXT("FunctionClass"))->DefaultObject = Function->GetOwnerClass();
+	RegisterFunc->FindPinChecked(TEXT("UnbindFunction"))->DefaultValue = Function->GetMetaData(PersistentMetadataName);
+	if (!Function->HasAnyFunctionFlags(FUNC_Static))
+	{
+		UEdGraphPin* SourcePin = RegisterFunc->FindPinChecked(TEXT("Source"));
+		UEdGraphPin* CallSelfPin = Schema->FindSelfPin(CallFunc, EGPD_Input);
+		if (CallSelfPin && CallSelfPin->LinkedTo.Num() > 0)
+		{
+			Schema->TryCreateConnection(CallSelfPin->LinkedTo[0], SourcePin);
+		}
+		else
+		{
+			UK2Node_Self* SelfNode = CompilerContext.SpawnIntermediateNode<UK2Node_Self>(this, SourceGraph);
+			SelfNode->AllocateDefaultPins();
+			Schema->TryCreateConnection(SelfNode->FindPinChecked(UEdGraphSchema_K2::PN_Self), SourcePin);
+		}
+	}
+
+	// The first output binds the delegates if they haven't been already. The second continues to whatever follows the node either way.
+	UK2Node_ExecutionSequence* SequenceNode = CompilerContext.SpawnIntermediateNode<UK2Node_ExecutionSequence>(this, SourceGraph);
+	SequenceNode->AllocateDefaultPins();
+
+	CompilerContext.MovePinLinksToIntermediate(*CallFunc.GetExecPin(), *SequenceNode->GetExecPin());
+	CompilerContext.MovePinLinksToIntermediate(*CallFunc.GetThenPin(), *SequenceNode->GetThenPinGivenIndex(1));
+	SequenceNode->GetThenPinGivenIndex(0)->MakeLinkTo(BranchNode->GetExecPin());
+	BranchNode->GetElsePin()->MakeLinkTo(AssignNode->GetExecPin());
+	AssignNode->GetThenPin()->MakeLinkTo(RegisterFunc->GetExecPin());
+	RegisterFunc->GetThenPin()->MakeLinkTo(CallFunc.GetExecPin());
+}
+
+const UFunction* UK2Node_NeatCallFunction::GetPersistentUnbindFunction() const
+{
+	const UFunction* Function = GetTargetFunction();
+	const FString* UnbindName = Function ? Function->FindMetaData(PersistentMetadataName) : nullptr;
+	if (!UnbindName || UnbindName->IsEmpty())
+		return nullptr;
+
+	const UFunction* UnbindFunction = Function->GetOwnerClass()->FindFunctionByName(**UnbindName);
+	if (!UnbindFunction || UnbindFunction->NumParms != 1 || !CastField<FObjectPropertyBase>(UnbindFunction->PropertyLink))
+		return nullptr;
+
+	// A static bind function has no object to call a member unbind function on.
+	if (Function->HasAnyFunctionFlags(FUNC_Static) && !UnbindFunction->HasAnyFunctionFlags(FUNC_Static))
+		return nullptr;
+
+	return UnbindFunction;
+}
+
 void UK2Node_NeatCallFunction::PinConnectionListChanged(UEdGraphPin* Pin)
 {
 	Super::PinConnectionListChanged(Pin);
@@ -176,6 +327,57 @@ void UK2Node_NeatCallFunction::PinConnectionListChanged(UEdGraphPin* Pin)
 void UK2Node_NeatCallFunction::ValidateNodeDuringCompilation(FCompilerResultsLog& MessageLog) const
 {
 	Super::ValidateNodeDuringCompilation(MessageLog);
+
+	if (!bIsNeatFunction)
+		return;
+
+	// A misspelled name in the metadata would otherwise just leave the delegate uncoalesced.
+	const UFunction* Fn = GetTargetFunction();
+	if (const FString* CoalescedDelegatesStr = Fn ? Fn->FindMetaData(CoalesceMetadataName) : nullptr)
+	{
+		TArray<FString> CoalescedDelegates;
+		CoalescedDelegatesStr->ParseIntoArray(CoalescedDelegates, TEXT(","), true);
+		for (const FString& DelegateName : CoalescedDelegates)
+		{
+			bool bFound = false;
+			ForEachEligableDelegateProperty([&](const FDelegateProperty& Prop)
+			{
+				bFound |= Prop.GetName() == DelegateName.TrimStartAndEnd();
+			});
+
+			if (!bFound)
+			{
+				MessageLog.Error(*FString::Printf(TEXT("@@ lists %s in its \"%s\" metadata, but %s has no delegate parameter with that name."),
+					*DelegateName.TrimStartAndEnd(), *CoalesceMetadataName.Resolve().ToString(), *Fn->GetName()), this);
+			}
+		}
+	}
+
+	// Without a function to remove them, persistent bindings would keep firing into destroyed owners for as long as the source keeps them.
+	if (Fn && Fn->HasMetaData(PersistentMetadataName) && !GetPersistentUnbindFunction())
+	{
+		MessageLog.Error(*FString::Printf(TEXT("@@ needs its \"%s\" metadata to name a function of %s that takes the owner as its only parameter, and removes the delegates bound to it."),
+			*PersistentMetadataName.Resolve().ToString(), *Fn->GetOwnerClass()->GetName()), this);
+	}
+
+	const UNeatFunctionsSettings* Settings = GetDefault<UNeatFunctionsSettings>();
+	if (Settings->LargeDelegatePayloadSeverity == ENeatLintSeverity::Ignore)
+		return;
+
+	// Every parameter of a delegate is copied into the outputs of the generated event each time it fires.
+	ForEachEligableDelegateProperty([&](const FDelegateProperty& Prop)
+	{
+		for (TFieldIterator<FProperty> PropIt(Prop.SignatureFunction); PropIt && (PropIt->PropertyFlags & CPF_Parm); ++PropIt)
+		{
+			const FStructProperty* StructParam = CastField<FStructProperty>(*PropIt);
+			if (StructParam && StructParam->GetSize() > Settings->LargeDelegatePayloadThreshold)
+			{
+				const FString Message = FString::Printf(TEXT("@@ copies %d bytes for parameter %s every time %s fires. Consider passing a smaller struct or an object."),
+					StructParam->GetSize(), *StructParam->GetName(), *Prop.GetName());
+				NeatFunctionsLint::Report(MessageLog, Settings->LargeDelegatePayloadSeverity, Message, this);
+			}
+		}
+	});
 }
 
 FSlateIcon UK2Node_NeatCallFunction::GetIconAndTint(FLinearColor& OutColor) const
@@ -220,6 +422,18 @@ public:
 		
 		SGraphNodeK2Default::AddPin(PinToAdd);
 	}
+
+protected:
+	virtual FSlateColor GetNodeBodyColor() const override
+	{
+		const TOptional<FLinearColor> HeatColor = NeatFunctionsProfiling::GetHeatColor(GraphNode);
+		return HeatColor.IsSet() ? FSlateColor(HeatColor.GetValue()) : SGraphNodeK2Default::GetNodeBodyColor();
+	}
+
+	virtual FText GetNodeTooltip() const override
+	{
+		return NeatFunctionsProfiling::AppendHeatTooltip(GraphNode, SGraphNodeK2Default::GetNodeTooltip());
+	}
 };
 
 TSharedPtr<SGraphNode> UK2Node_NeatCallFunction::CreateVisualWidget()
@@ -245,7 +459,7 @@ namespace
 }
 
 
-void UK2Node_NeatCallFunction::ForEachEligableDelegateProperty(FForEachDelegateFunction InFn)
+void UK2Node_NeatCallFunction::ForEachEligableDelegateProperty(FForEachDelegateFunction InFn) const
 {
 	for (const FDelegateProperty* Prop : TFieldRange<FDelegateProperty>(GetTargetFunction()))
 	{
@@ -254,6 +468,77 @@ void UK2Node_NeatCallFunction::ForEachEligableDelegateProperty(FForEachDelegateF
 	}
 }
 
+void UK2Node_NeatCallFunction::ReportPersistentFrameUsage(FCompilerResultsLog& MessageLog)
+{
+	// Outputs of the generated events are stored in the ubergraph's persistent frame, which is allocated for every instance.
+	int32 TotalBytes = 0;
+	int32 UnreadBytes = 0;
+	ForEachEligableDelegateProperty([&](const FDelegateProperty& Prop)
+	{
+		// Matches ExpandNode, which doesn't generate events for delegates nothing uses.
+		if (!IsDelegateUsed(Prop) && !NeatFunctionsProfiling::ShouldRecordNodes())
+			return;
+
+		for (TFieldIterator<FProperty> PropIt(Prop.SignatureFunction); PropIt && (PropIt->PropertyFlags & CPF_Parm); ++PropIt)
+		{
+			const FProperty* Param = *PropIt;
+			const bool bIsFunctionInput = !Param->HasAnyPropertyFlags(CPF_OutParm) || Param->HasAnyPropertyFlags(CPF_ReferenceParm);
+			if (!bIsFunctionInput)
+				continue;
+
+			// Frame properties are laid out at their alignment, so each one takes at least its size rounded up to it.
+			const int32 ParamBytes = Align(Param->GetSize(), Param->GetMinAlignment());
+			TotalBytes += ParamBytes;
+
+			const UEdGraphPin* Pin = FindPin(FName(FString::Printf(TEXT("%s_%s"), *Prop.GetName(), *Param->GetName())));
+			if (!Pin || Pin->LinkedTo.Num() == 0)
+				UnreadBytes += ParamBytes;
+		}
+	});
+
+	if (TotalBytes > 0)
+	{
+		MessageLog.Note(*FString::Printf(TEXT("@@ adds %d bytes to the persistent frame of each instance, %d of which belong to delegate parameters that are never read."), TotalBytes, UnreadBytes), this);
+	}
+}
+
+bool UK2Node_NeatCallFunction::IsDelegateCoalesced(const FDelegateProperty& Prop) const
+{
+	const UFunction* Fn = GetTargetFunction();
+	const FString* CoalescedDelegatesStr = Fn ? Fn->FindMetaData(CoalesceMetadataName) : nullptr;
+	if (!CoalescedDelegatesStr)
+		return false;
+
+	TArray<FString> CoalescedDelegates;
+	CoalescedDelegatesStr->ParseIntoArray(CoalescedDelegates, TEXT(","), true);
+	for (const FString& DelegateName : CoalescedDelegates)
+	{
+		if (Prop.GetName() == DelegateName.TrimStartAndEnd())
+			return true;
+	}
+	return false;
+}
+
+FName UK2Node_NeatCallFunction::GetCoalescedCountPinName(const FDelegateProperty& Prop)
+{
+	return FName(FString::Printf(TEXT("%s_CoalescedCount"), *Prop.GetName()));
+}
+
+bool UK2Node_NeatCallFunction::IsDelegateUsed(const FDelegateProperty& Prop) const
+{
+	const UEdGraphPin* ThenPin = FindPin(Prop.GetFName());
+	if (ThenPin && ThenPin->LinkedTo.Num() > 0)
+		return true;
+
+	for (TFieldIterator<FProperty> PropIt(Prop.SignatureFunction); PropIt && (PropIt->PropertyFlags & CPF_Parm); ++PropIt)
+	{
+		const UEdGraphPin* ParamPin = FindPin(FName(FString::Printf(TEXT("%s_%s"), *Prop.GetName(), *PropIt->GetName())));
+		if (ParamPin && ParamPin->LinkedTo.Num() > 0)
+			return true;
+	}
+	return false;
+}
+
 void UK2Node_NeatCallFunction::QueueDestroyAutomaticExecConnection(TWeakObjectPtr<UEdGraphNode> OtherNode)
 {
 	GEditor->GetTimerManager()->SetTimerForNextTick(FTimerDelegate::CreateWeakLambda(this, [this, OtherNode]()
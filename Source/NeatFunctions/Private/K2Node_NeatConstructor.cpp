@@ -5,12 +5,18 @@
 
 #include "BlueprintActionDatabaseRegistrar.h"
 #include "BlueprintCompilationManager.h"
-#include "BlueprintFunctionNodeSpawner.h"
+#include "K2Node_AssignmentStatement.h"
 #include "K2Node_CallArrayFunction.h"
 #include "K2Node_IfThenElse.h"
+#include "K2Node_TemporaryVariable.h"
 #include "KismetCompiler.h"
 #include "Kismet/GameplayStatics.h"
 #include "Kismet2/BlueprintEditorUtils.h"
+#include "KismetNodes/SGraphNodeK2Default.h"
+#include "NeatFunctionIndex.h"
+#include "NeatFunctionNodeSpawner.h"
+#include "NeatFunctionsLint.h"
+#include "NeatFunctionsProfiling.h"
 #include "NeatFunctionsRuntime/Public/NeatFunctionsStatics.h"
 #include "Styling/SlateIconFinder.h"
 
@@ -20,8 +26,36 @@ namespace
 {
 	const UClass* GetClassParameterMetaClass(const UFunction& InFunction)
 	{
-		const FClassProperty* ClassProp = CastField<FClassProperty>(InFunction.FindPropertyByName(NAME_Class));
-		return ClassProp ? ClassProp->MetaClass : nullptr;
+		const FProperty* Prop = InFunction.FindPropertyByName(NAME_Class);
+		if (const FClassProperty* ClassProp = CastField<FClassProperty>(Prop))
+			return ClassProp->MetaClass;
+
+		if (const FSoftClassProperty* SoftClassProp = CastField<FSoftClassProperty>(Prop))
+			return SoftClassProp->MetaClass;
+
+		return nullptr;
+	}
+
+	// Containers, strings and structs with heap allocations, whose copies have to allocate and copy every element.
+	bool IsExpensiveToCopy(const FProperty& Property)
+	{
+		if (Property.IsA<FArrayProperty>() || Property.IsA<FMapProperty>() || Property.IsA<FSetProperty>() || Property.IsA<FStrProperty>())
+			return true;
+
+		const FStructProperty* StructProp = CastField<FStructProperty>(&Property);
+		return StructProp && !(StructProp->Struct->StructFlags & STRUCT_IsPlainOldData);
+	}
+
+	// Whether the pin reads the output of a pure function call that nothing else reads, so the value can be taken from it.
+	bool IsSingleUseTemporary(const UEdGraphPin& Pin)
+	{
+		if (Pin.LinkedTo.Num() != 1)
+			return false;
+
+		// Only the outputs of function calls are temporaries. Variables, and references into other values, must never be moved from.
+		const UEdGraphPin* SourcePin = Pin.LinkedTo[0];
+		const UK2Node_CallFunction* SourceNode = Cast<UK2Node_CallFunction>(SourcePin->GetOwningNode());
+		return SourceNode && SourceNode->IsNodePure() && SourcePin->LinkedTo.Num() == 1 && !SourcePin->PinType.bIsReference;
 	}
 
 	bool HasValidReturnValue(const UFunction& InFunction)
@@ -76,6 +110,19 @@ namespace
 		return true;
 	}
 
+	// Menu actions are registered again every time the action database is refreshed, so each broken function is only reported once.
+	void LogInvalidFunction(const UFunction& Fn, const FString& Error)
+	{
+		static TSet<FObjectKey> ReportedFunctions;
+
+		bool bAlreadyReported = false;
+		ReportedFunctions.Add(FObjectKey(&Fn), &bAlreadyReported);
+		if (!bAlreadyReported)
+		{
+			UE_LOG(LogNeatFunctions, Error, TEXT("Cannot create NeatConstructor for %s. %s"), *GetNameSafe(&Fn), *Error);
+		}
+	}
+
 	bool ValidateFunction(const UFunction* InFunction)
 	{
 		if (!InFunction)
@@ -89,20 +136,20 @@ namespace
 
 		if (!GetClassParameterMetaClass(Fn))
 		{
-			UE_LOG(LogNeatFunctions, Error, TEXT("Cannot create NeatConstructor for %s. Function does not have a parameter named \"Class\". This parameter must be of `TSubclassOf<SomeType>`"), *GetNameSafe(&Fn))
+			LogInvalidFunction(Fn, TEXT("Function does not have a parameter named \"Class\". This parameter must be of `TSubclassOf<SomeType>` or `TSoftClassPtr<SomeType>`"));
 			return false;
 		}
 
 		if (!HasValidReturnValue(Fn))
 		{
-			UE_LOG(LogNeatFunctions, Error, TEXT("Cannot create NeatConstructor for %s. Function does not have a valid return value. Must return an object of the same class as the \"Class\" parameter."), *GetNameSafe(&Fn))
+			LogInvalidFunction(Fn, TEXT("Function does not have a valid return value. Must return an object of the same class as the \"Class\" parameter."));
 			return false;
 		}
 
 		FString Error;
 		if (!HasValidFinishFunction(Fn, Error))
 		{
-			UE_LOG(LogNeatFunctions, Error, TEXT("Cannot create NeatConstructor for %s. Function does not have a valid finish function. %s"), *GetNameSafe(&Fn), *Error);
+			LogInvalidFunction(Fn, FString::Printf(TEXT("Function does not have a valid finish function. %s"), *Error));
 			return false;
 		}
 		
@@ -113,31 +160,24 @@ namespace
 void UK2Node_NeatConstructor::GetMenuActions(FBlueprintActionDatabaseRegistrar& ActionRegistrar) const
 {
 	UClass* NodeClass = GetClass();
-	if (ActionRegistrar.IsOpenForRegistration(NodeClass))
+	for (const UFunction* Fn : TObjectRange<UFunction>())
 	{
-		for (const UFunction* Fn : TObjectRange<UFunction>())
-		{
-			if (!ValidateFunction(Fn))
-				continue;
-
-			UBlueprintFieldNodeSpawner* NodeSpawner = UBlueprintFieldNodeSpawner::Create(NodeClass, Fn);
-			check(NodeSpawner != nullptr);
+		// Actions are keyed on the class owning the function, so only the functions of a class that changed are registered again.
+		if (!Fn || !ActionRegistrar.IsOpenForRegistration(Fn->GetOwnerClass()) || !ValidateFunction(Fn))
+			continue;
 
-			NodeSpawner->DefaultMenuSignature.MenuName = UK2Node_CallFunction::GetUserFacingFunctionName(Fn);
-			NodeSpawner->DefaultMenuSignature.Category = UK2Node_CallFunction::GetDefaultCategoryForFunction(Fn, FText::GetEmpty());
-			NodeSpawner->DefaultMenuSignature.Tooltip = FText::FromString(UK2Node_CallFunction::GetDefaultTooltipForFunction(Fn));
-			NodeSpawner->DefaultMenuSignature.Keywords = UK2Node_CallFunction::GetKeywordsForFunction(Fn);
+		UNeatFunctionNodeSpawner* NodeSpawner = UNeatFunctionNodeSpawner::Create(NodeClass, Fn, [](const UFunction& Function)
+		{
+			return FSlateIconFinder::FindIconForClass(GetClassParameterMetaClass(Function));
+		});
 
-			NodeSpawner->DefaultMenuSignature.Icon = FSlateIconFinder::FindIconForClass(GetClassParameterMetaClass(*Fn));
-			NodeSpawner->DefaultMenuSignature.IconTint = FLinearColor::White;
-			NodeSpawner->CustomizeNodeDelegate.BindLambda([Fn](UEdGraphNode* Node, bool)
-			{
-				ThisClass* ThisNode = Cast<ThisClass>(Node);
-				ThisNode->FunctionReference.SetFromField<UFunction>(Fn, ThisNode->GetBlueprintClassFromNode());
-			});
+		NodeSpawner->CustomizeNodeDelegate.BindLambda([Fn](UEdGraphNode* Node, bool)
+		{
+			ThisClass* ThisNode = Cast<ThisClass>(Node);
+			ThisNode->FunctionReference.SetFromField<UFunction>(Fn, ThisNode->GetBlueprintClassFromNode());
+		});
 
-			ActionRegistrar.AddBlueprintAction(NodeClass, NodeSpawner);
-		}
+		ActionRegistrar.AddBlueprintAction(Fn->GetOwnerClass(), NodeSpawner);
 	}
 }
 
@@ -145,6 +185,12 @@ void UK2Node_NeatConstructor::AllocateDefaultPins()
 {
 	Super::AllocateDefaultPins();
 
+	if (IsSoftClass())
+	{
+		// A soft class pin stores the selected class as a path, so picking a class doesn't create a hard reference to it.
+		GetClassPin()->PinType.PinCategory = UEdGraphSchema_K2::PC_SoftClass;
+	}
+
 	if (GetTargetFunction()->HasMetaData(NeatValidationMetadataName))
 	{
 		FCreatePinParams Params;
@@ -156,8 +202,20 @@ void UK2Node_NeatConstructor::AllocateDefaultPins()
 		GetThenPin()->PinToolTip = TEXT("Executed when we spawned an object successfully.");
 	}
 
+	if (GetTargetFunction()->HasMetaData(NeatSpawnPropertiesMetadataName))
+	{
+		FCreatePinParams Params;
+		Params.ContainerType = EPinContainerType::Map;
+		Params.ValueTerminalType.TerminalCategory = UEdGraphSchema_K2::PC_String;
+		UEdGraphPin* SpawnPropertiesPin = CreatePin(EGPD_Input, UEdGraphSchema_K2::PC_Name, SpawnPropertiesPinName, Params);
+		SpawnPropertiesPin->PinFriendlyName = INVTEXT("Spawn Properties");
+		SpawnPropertiesPin->PinToolTip = TEXT("Property values to assign by name, in text form. Can set properties of any subclass, even when the class is only known at runtime.");
+	}
+
 	CreatePinsForFunction(GetTargetFunction());
 	CreatePinsForFunction(GetFinishFunction());
+
+	FNeatFunctionIndex::Get().Register(this, GetTargetFunction());
 }
 
 void UK2Node_NeatConstructor::ExpandNode(FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph)
@@ -165,8 +223,8 @@ void UK2Node_NeatConstructor::ExpandNode(FKismetCompilerContext& CompilerContext
 	Super::ExpandNode(CompilerContext, SourceGraph);
 
 	const UEdGraphPin* SpawnClassPin = GetClassPin();
-	const UClass* SpawnClass = SpawnClassPin ? Cast<UClass>(SpawnClassPin->DefaultObject) : nullptr;
-	if (!SpawnClassPin || ((!SpawnClass) && (SpawnClassPin->LinkedTo.Num() == 0)))
+	const bool bHasClassDefault = SpawnClassPin && (IsSoftClass() ? !SpawnClassPin->DefaultValue.IsEmpty() : Cast<UClass>(SpawnClassPin->DefaultObject) != nullptr);
+	if (!SpawnClassPin || ((!bHasClassDefault) && (SpawnClassPin->LinkedTo.Num() == 0)))
 	{
 		CompilerContext.MessageLog.Error(TEXT("@@ must have a class specified"), this);
 		// we break exec links so this is the only error we get, don't want this node being considered and giving 'unexpected node' type warnings
@@ -175,7 +233,7 @@ void UK2Node_NeatConstructor::ExpandNode(FKismetCompilerContext& CompilerContext
 	}
 
 	// A few lines down we move the class pin, so cache off the ClassToSpawn before doing that.
-	const UClass* ClassToSpawn = GetClassToSpawn();
+	const UClass* ClassToSpawn = IsSoftClass() && SpawnClassPin->LinkedTo.Num() == 0 ? GetSoftClassDefault() : GetClassToSpawn();
 
 	
 	UK2Node_CallFunction* BeginSpawnFunc = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(this, SourceGraph);
@@ -185,8 +243,45 @@ void UK2Node_NeatConstructor::ExpandNode(FKismetCompilerContext& CompilerContext
 	BeginSpawnFunc->GetReturnValuePin()->PinType = GetResultPin()->PinType;
 	BeginSpawnFunc->PinTypeChanged(BeginSpawnFunc->GetReturnValuePin());
 
-	CompilerContext.MovePinLinksToIntermediate(*GetExecPin(), *BeginSpawnFunc->GetExecPin());
-	CompilerContext.MovePinLinksToIntermediate(*GetClassPin(), *BeginSpawnFunc->FindPin(NAME_Class));
+	if (IsSoftClass())
+	{
+		// Stream the class in before calling the spawn function, which then receives the (now loaded) soft class.
+		UK2Node_CallFunction* LoadClassFunc = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(this, SourceGraph);
+		LoadClassFunc->SetFromFunction(UNeatFunctionsStatics::StaticClass()->FindFunctionByName(GET_MEMBER_NAME_CHECKED(UNeatFunctionsStatics, LoadNeatClassAsync)));
+		LoadClassFunc->AllocateDefaultPins();
+
+		if (GetClassPin()->LinkedTo.Num() > 0)
+		{
+			// Both the load and the spawn function need the class, so evaluate whatever is connected to the pin only once.
+			UK2Node_TemporaryVariable* ClassVar = CompilerContext.SpawnIntermediateNode<UK2Node_TemporaryVariable>(this, SourceGraph);
+			ClassVar->VariableType = GetClassPin()->PinType;
+			ClassVar->AllocateDefaultPins();
+
+			UK2Node_AssignmentStatement* AssignClass = CompilerContext.SpawnIntermediateNode<UK2Node_AssignmentStatement>(this, SourceGraph);
+			AssignClass->AllocateDefaultPins();
+			ClassVar->GetVariablePin()->MakeLinkTo(AssignClass->GetVariablePin());
+			AssignClass->NotifyPinConnectionListChanged(AssignClass->GetVariablePin());
+			CompilerContext.MovePinLinksToIntermediate(*GetClassPin(), *AssignClass->GetValuePin());
+
+			CompilerContext.MovePinLinksToIntermediate(*GetExecPin(), *AssignClass->GetExecPin());
+			AssignClass->GetThenPin()->MakeLinkTo(LoadClassFunc->GetExecPin());
+
+			ClassVar->GetVariablePin()->MakeLinkTo(LoadClassFunc->FindPinChecked(NAME_Class));
+			ClassVar->GetVariablePin()->MakeLinkTo(BeginSpawnFunc->FindPinChecked(NAME_Class));
+		}
+		else
+		{
+			CompilerContext.MovePinLinksToIntermediate(*GetExecPin(), *LoadClassFunc->GetExecPin());
+			CompilerContext.CopyPinLinksToIntermediate(*GetClassPin(), *LoadClassFunc->FindPinChecked(NAME_Class));
+			CompilerContext.MovePinLinksToIntermediate(*GetClassPin(), *BeginSpawnFunc->FindPin(NAME_Class));
+		}
+		LoadClassFunc->GetThenPin()->MakeLinkTo(BeginSpawnFunc->GetExecPin());
+	}
+	else
+	{
+		CompilerContext.MovePinLinksToIntermediate(*GetExecPin(), *BeginSpawnFunc->GetExecPin());
+		CompilerContext.MovePinLinksToIntermediate(*GetClassPin(), *BeginSpawnFunc->FindPin(NAME_Class));
+	}
 	CompilerContext.MovePinLinksToIntermediate(*GetResultPin(), *BeginSpawnFunc->GetReturnValuePin());
 
 	for (UEdGraphPin* CurrentPin : Pins)
@@ -209,7 +304,92 @@ void UK2Node_NeatConstructor::ExpandNode(FKismetCompilerContext& CompilerContext
 		}
 	}
 
-	UEdGraphPin* LastThen = FKismetCompilerUtilities::GenerateAssignmentNodes(CompilerContext, SourceGraph, BeginSpawnFunc, this, BeginSpawnFunc->GetReturnValuePin(), ClassToSpawn);
+	// Containers that come straight from a temporary are moved into the object once everything else has been assigned, instead of copied.
+	// Their links are taken here, so GenerateAssignmentNodes doesn't also create assignments for them.
+	// Other expensive values are still copied by the assignment nodes, and counted afterwards.
+	TArray<UK2Node_CallFunction*> MoveFuncs;
+	TArray<UK2Node_CallFunction*> CountFuncs;
+	for (UEdGraphPin* CurrentPin : Pins)
+	{
+		const FProperty* Property = ClassToSpawn && CurrentPin && IsSpawnVarPin(CurrentPin) ? FindFProperty<FProperty>(ClassToSpawn, CurrentPin->PinName) : nullptr;
+		if (!Property || !IsExpensiveToCopy(*Property) || CurrentPin->LinkedTo.Num() == 0)
+			continue;
+
+		// Properties with a setter must keep going through it.
+		if (Property->HasMetaData(FBlueprintMetadata::MD_PropertySetFunction) || !UNeatFunctionsStatics::CanMoveProperty(*Property) || !IsSingleUseTemporary(*CurrentPin))
+		{
+			UK2Node_CallFunction* CountFunc = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(this, SourceGraph);
+			CountFunc->SetFromFunction(UNeatFunctionsStatics::StaticClass()->FindFunctionByName(GET_MEMBER_NAME_CHECKED(UNeatFunctionsStatics, NeatCountCopiedBytes)));
+			CountFunc->AllocateDefaultPins();
+
+			CountFunc->FindPinChecked(TEXT("PropertyName"))->DefaultValue = CurrentPin->PinName.ToString();
+			BeginSpawnFunc->GetReturnValuePin()->MakeLinkTo(CountFunc->FindPinChecked(TEXT("Object")));
+
+			CountFuncs.Add(CountFunc);
+			continue;
+		}
+
+		UK2Node_CallFunction* MoveFunc = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(this, SourceGraph);
+		MoveFunc->SetFromFunction(UNeatFunctionsStatics::StaticClass()->FindFunctionByName(GET_MEMBER_NAME_CHECKED(UNeatFunctionsStatics, NeatMoveIntoProperty)));
+		MoveFunc->AllocateDefaultPins();
+
+		UEdGraphPin* ValuePin = MoveFunc->FindPinChecked(TEXT("Value"));
+		ValuePin->PinType = CurrentPin->PinType;
+		ValuePin->PinType.bIsReference = true;
+		MoveFunc->FindPinChecked(TEXT("PropertyName"))->DefaultValue = CurrentPin->PinName.ToString();
+		BeginSpawnFunc->GetReturnValuePin()->MakeLinkTo(MoveFunc->FindPinChecked(TEXT("Object")));
+		CompilerContext.MovePinLinksToIntermediate(*CurrentPin, *ValuePin);
+
+		// Match the autogenerated default, so neither the archetype nor the assignment nodes consider the pin as having a value.
+		GetDefault<UEdGraphSchema_K2>()->ResetPinToAutogeneratedDefaultValue(CurrentPin, false);
+
+		MoveFuncs.Add(MoveFunc);
+	}
+
+	UEdGraphPin* LastThen = nullptr;
+	if (UObject* Archetype = CreateSpawnArchetype(CompilerContext, ClassToSpawn))
+	{
+		// All values are literals, so copy them from the archetype in one go instead of generating an assignment node per property.
+		UK2Node_CallFunction* ApplyArchetypeFunc = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(this, SourceGraph);
+		ApplyArchetypeFunc->SetFromFunction(UNeatFunctionsStatics::StaticClass()->FindFunctionByName(GET_MEMBER_NAME_CHECKED(UNeatFunctionsStatics, ApplyNeatArchetype)));
+		ApplyArchetypeFunc->AllocateDefaultPins();
+
+		BeginSpawnFunc->GetThenPin()->MakeLinkTo(ApplyArchetypeFunc->GetExecPin());
+		BeginSpawnFunc->GetReturnValuePin()->MakeLinkTo(ApplyArchetypeFunc->FindPinChecked(TEXT("Object")));
+		ApplyArchetypeFunc->FindPinChecked(TEXT("Archetype"))->DefaultObject = Archetype;
+
+		LastThen = ApplyArchetypeFunc->GetThenPin();
+	}
+	else
+	{
+		LastThen = FKismetCompilerUtilities::GenerateAssignmentNodes(CompilerContext, SourceGraph, BeginSpawnFunc, this, BeginSpawnFunc->GetReturnValuePin(), ClassToSpawn);
+	}
+
+	for (UK2Node_CallFunction* Func : CountFuncs)
+	{
+		LastThen->MakeLinkTo(Func->GetExecPin());
+		LastThen = Func->GetThenPin();
+	}
+
+	for (UK2Node_CallFunction* MoveFunc : MoveFuncs)
+	{
+		LastThen->MakeLinkTo(MoveFunc->GetExecPin());
+		LastThen = MoveFunc->GetThenPin();
+	}
+
+	UEdGraphPin* SpawnPropertiesPin = FindPin(SpawnPropertiesPinName, EGPD_Input);
+	if (SpawnPropertiesPin && SpawnPropertiesPin->LinkedTo.Num() > 0)
+	{
+		UK2Node_CallFunction* SetPropertiesFunc = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(this, SourceGraph);
+		SetPropertiesFunc->SetFromFunction(UNeatFunctionsStatics::StaticClass()->FindFunctionByName(GET_MEMBER_NAME_CHECKED(UNeatFunctionsStatics, SetNeatSpawnProperties)));
+		SetPropertiesFunc->AllocateDefaultPins();
+
+		CompilerContext.MovePinLinksToIntermediate(*SpawnPropertiesPin, *SetPropertiesFunc->FindPinChecked(TEXT("Properties")));
+		BeginSpawnFunc->GetReturnValuePin()->MakeLinkTo(SetPropertiesFunc->FindPinChecked(TEXT("Object")));
+
+		LastThen->MakeLinkTo(SetPropertiesFunc->GetExecPin());
+		LastThen = SetPropertiesFunc->GetThenPin();
+	}
 
 	if (GetFinishFunction())
 	{
@@ -241,7 +421,30 @@ void UK2Node_NeatConstructor::ExpandNode(FKismetCompilerContext& CompilerContext
 		LastThen->MakeLinkTo(FinishSpawnFunc->GetExecPin());
 		LastThen = FinishSpawnFunc->GetThenPin();
 	}
+
+	if (GetTargetFunction()->HasMetaData(NeatClusteredMetadataName))
+	{
+		UK2Node_CallFunction* AddToClusterFunc = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(this, SourceGraph);
+		AddToClusterFunc->SetFromFunction(UNeatFunctionsStatics::StaticClass()->FindFunctionByName(GET_MEMBER_NAME_CHECKED(UNeatFunctionsStatics, AddToNeatCluster)));
+		AddToClusterFunc->AllocateDefaultPins();
+
+		BeginSpawnFunc->GetReturnValuePin()->MakeLinkTo(AddToClusterFunc->FindPinChecked(TEXT("Object")));
+
+		LastThen->MakeLinkTo(AddToClusterFunc->GetExecPin());
+		LastThen = AddToClusterFunc->GetThenPin();
+	}
 	
+	if (NeatFunctionsProfiling::ShouldRecordNodes())
+	{
+		LastThen = NeatFunctionsProfiling::AppendRecordConstruction(CompilerContext, SourceGraph, this, *LastThen, GetTargetFunction(), *BeginSpawnFunc->GetReturnValuePin());
+	}
+
+	if (NeatFunctionsProfiling::ShouldInstrumentNodes())
+	{
+		NeatFunctionsProfiling::InsertBeginSample(CompilerContext, SourceGraph, this, *BeginSpawnFunc->GetExecPin());
+		LastThen = NeatFunctionsProfiling::AppendEndSample(CompilerContext, SourceGraph, this, *LastThen);
+	}
+
 	if (GetTargetFunction()->HasMetaData(NeatValidationMetadataName))
 	{
 		UK2Node_CallFunction* IsValidFuncNode = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(this, SourceGraph);
@@ -266,15 +469,73 @@ void UK2Node_NeatConstructor::ExpandNode(FKismetCompilerContext& CompilerContext
 	CompilerContext.MovePinLinksToIntermediate(*GetThenPin(), *LastThen);
 }
 
-UClass* UK2Node_NeatConstructor::GetClassPinBaseClass() const
+UObject* UK2Node_NeatConstructor::CreateSpawnArchetype(FKismetCompilerContext& CompilerContext, const UClass* ClassToSpawn) const
 {
-	if (const UFunction* Fn = GetTargetFunction())
+	const UEdGraphPin* SpawnClassPin = GetClassPin();
+	if (!ClassToSpawn || !SpawnClassPin || SpawnClassPin->LinkedTo.Num() > 0)
+		return nullptr;
+
+	// The archetype would be a hard reference to the class, which is exactly what soft classes are meant to avoid.
+	if (IsSoftClass())
+		return nullptr;
+
+	if (ClassToSpawn->HasAnyClassFlags(CLASS_Abstract | CLASS_Deprecated | CLASS_NewerVersionExists))
+		return nullptr;
+
+	TArray<TPair<const FProperty*, const UEdGraphPin*>> Assignments;
+	for (UEdGraphPin* Pin : Pins)
+	{
+		if (!Pin || Pin->PinType.PinCategory == UEdGraphSchema_K2::PC_Exec || !IsSpawnVarPin(Pin))
+			continue;
+
+		if (Pin->LinkedTo.Num() > 0)
+			return nullptr;
+
+		const FProperty* Property = FindFProperty<FProperty>(ClassToSpawn, Pin->PinName);
+		if (!Property)
+			continue;
+
+		// Setter functions may have side effects, so they need to run through the regular assignment nodes.
+		if (Property->HasMetaData(FBlueprintMetadata::MD_PropertySetFunction))
+			return nullptr;
+
+		if (!Pin->DoesDefaultValueMatchAutogenerated())
+			Assignments.Emplace(Property, Pin);
+	}
+
+	// Nothing to assign, so the assignment path won't generate any nodes either.
+	if (Assignments.Num() == 0)
+		return nullptr;
+
+	// The archetype is outered to the generated class, so it is saved and cooked along with the bytecode that references it.
+	const FName ArchetypeName(*FString::Printf(TEXT("NeatArchetype_%s"), *CompilerContext.GetGuid(this)));
+	if (UObject* Existing = StaticFindObjectFast(nullptr, CompilerContext.NewClass, ArchetypeName))
+	{
+		Existing->Rename(nullptr, GetTransientPackage(), REN_DontCreateRedirectors | REN_DoNotDirty | REN_NonTransactional);
+		Existing->ClearFlags(RF_ArchetypeObject | RF_Public);
+		Existing->MarkAsGarbage();
+	}
+
+	UObject* Archetype = NewObject<UObject>(CompilerContext.NewClass, const_cast<UClass*>(ClassToSpawn), ArchetypeName, RF_Public | RF_ArchetypeObject);
+	for (const TPair<const FProperty*, const UEdGraphPin*>& Assignment : Assignments)
 	{
-		const FClassProperty* ClassProp = CastField<FClassProperty>(Fn->FindPropertyByName(NAME_Class));
-		if (!ClassProp)
+		if (!FBlueprintEditorUtils::PropertyValueFromString(Assignment.Key, Assignment.Value->GetDefaultAsString(), reinterpret_cast<uint8*>(Archetype), Archetype))
+		{
+			Archetype->Rename(nullptr, GetTransientPackage(), REN_DontCreateRedirectors | REN_DoNotDirty | REN_NonTransactional);
+			Archetype->ClearFlags(RF_ArchetypeObject | RF_Public);
+			Archetype->MarkAsGarbage();
 			return nullptr;
+		}
+	}
+
+	return Archetype;
+}
 
-		return ClassProp->MetaClass;
+UClass* UK2Node_NeatConstructor::GetClassPinBaseClass() const
+{
+	if (const UFunction* Fn = GetTargetFunction())
+	{
+		return const_cast<UClass*>(GetClassParameterMetaClass(*Fn));
 	}
 
 	return AActor::StaticClass();
@@ -302,10 +563,63 @@ void UK2Node_NeatConstructor::CreatePinsForClass(UClass* InClass, TArray<UEdGrap
 		}
 	}
 
+	// Typing the result as the selected class would make the compiled Blueprint reference it, so soft classes keep the base class.
+	if (IsSoftClass())
+	{
+		GetResultPin()->PinType.PinSubCategoryObject = GetClassPinBaseClass();
+	}
+
 	if (OutClassPins)
 		OutClassPins->Append(MoveTemp(CreatedPins));
 }
 
+void UK2Node_NeatConstructor::ReallocatePinsDuringReconstruction(TArray<UEdGraphPin*>& OldPins)
+{
+	Super::ReallocatePinsDuringReconstruction(OldPins);
+
+	// The base node only knows about hard class defaults, so create the pins for a selected soft class ourselves.
+	if (UClass* SoftClass = GetSoftClassDefault(&OldPins))
+	{
+		CreatePinsForClass(SoftClass);
+	}
+}
+
+void UK2Node_NeatConstructor::PinDefaultValueChanged(UEdGraphPin* ChangedPin)
+{
+	// The base node only knows about hard classes, and would drop the pins of a soft class without restoring their links.
+	// Reconstructing creates the pins for the new class through ReallocatePinsDuringReconstruction, and keeps the links of pins that still exist.
+	if (ChangedPin && ChangedPin == GetClassPin() && IsSoftClass())
+	{
+		ReconstructNode();
+		FBlueprintEditorUtils::MarkBlueprintAsModified(GetBlueprint());
+		return;
+	}
+
+	Super::PinDefaultValueChanged(ChangedPin);
+}
+
+FText UK2Node_NeatConstructor::GetNodeTitle(ENodeTitleType::Type TitleType) const
+{
+	const UEdGraphPin* ClassPin = IsSoftClass() ? GetClassPin() : nullptr;
+	if (TitleType != ENodeTitleType::ListView && ClassPin && ClassPin->LinkedTo.Num() == 0 && !ClassPin->DefaultValue.IsEmpty())
+	{
+		FFormatNamedArguments Args;
+		Args.Add(TEXT("ClassName"), FText::FromString(FSoftClassPath(ClassPin->DefaultValue).GetAssetName()));
+		return FText::Format(GetNodeTitleFormat(), Args);
+	}
+	return Super::GetNodeTitle(TitleType);
+}
+
+FName UK2Node_NeatConstructor::GetCornerIcon() const
+{
+	return IsSoftClass() ? FName(TEXT("Graph.Latent.LatentIcon")) : Super::GetCornerIcon();
+}
+
+bool UK2Node_NeatConstructor::IsLatentForMacros() const
+{
+	return IsSoftClass();
+}
+
 bool UK2Node_NeatConstructor::IsSpawnVarPin(UEdGraphPin* Pin) const
 {
 	for (TFieldIterator<FProperty> PropIt(GetTargetFunction()); PropIt && (PropIt->PropertyFlags & CPF_Parm); ++PropIt)
@@ -323,6 +637,9 @@ bool UK2Node_NeatConstructor::IsSpawnVarPin(UEdGraphPin* Pin) const
 	if (Pin->GetFName() == UEdGraphSchema_K2::PN_Else)
 		return false;
 
+	if (Pin->GetFName() == SpawnPropertiesPinName)
+		return false;
+
 	if (Pin->GetFName() == GetFinishFunctionObjectInputName())
 		return false;
 
@@ -385,6 +702,38 @@ void UK2Node_NeatConstructor::EarlyValidation(FCompilerResultsLog& MessageLog) c
 	if (!GetTargetFunction())
 	{
 		MessageLog.Error(TEXT("@@ references function \"@@\" that has been removed from class @@"), this, *FunctionReference.GetMemberName().ToString(), FunctionReference.GetMemberParentClass());
+		return;
+	}
+
+	const UNeatFunctionsSettings* Settings = GetDefault<UNeatFunctionsSettings>();
+
+	// Functions can opt out of the checks with "NeatLintIgnore", e.g. when they reuse objects from a pool of their own.
+	if (GetTargetFunction()->HasMetaData(NeatLintIgnoreMetadataName))
+		return;
+
+	// Components with deferred registration are registered in batches, so constructing many of them in a row is what they're made for.
+	const bool bIsBatched = GetTargetFunction()->HasMetaData(NeatDeferredRegistrationMetadataName);
+	FString HotPathSource;
+	if (Settings->ConstructorInTickOrLoopSeverity != ENeatLintSeverity::Ignore && !bIsBatched && NeatFunctionsLint::IsReachableFromTickOrLoop(this, HotPathSource))
+	{
+		const FString Message = FString::Printf(TEXT("@@ constructs a new object every time %s runs. Consider pooling, or constructing the objects up front."), *HotPathSource);
+		NeatFunctionsLint::Report(MessageLog, Settings->ConstructorInTickOrLoopSeverity, Message, this);
+	}
+
+	if (Settings->PureSpawnPinChainsSeverity != ENeatLintSeverity::Ignore)
+	{
+		int32 NumPureChains = 0;
+		for (UEdGraphPin* Pin : Pins)
+		{
+			if (IsSpawnVarPin(Pin) && NeatFunctionsLint::IsLinkedToPureChain(Pin))
+				NumPureChains++;
+		}
+
+		if (NumPureChains >= Settings->PureSpawnPinChainsThreshold)
+		{
+			const FString Message = FString::Printf(TEXT("@@ has %d ExposeOnSpawn pins connected to pure nodes, which are evaluated again for each assignment. Consider storing the results in local variables first."), NumPureChains);
+			NeatFunctionsLint::Report(MessageLog, Settings->PureSpawnPinChainsSeverity, Message, this);
+		}
 	}
 }
 
@@ -407,6 +756,37 @@ namespace
 	}
 }
 
+class SNeatConstructorNode : public SGraphNodeK2Default
+{
+public:
+	SLATE_BEGIN_ARGS(SNeatConstructorNode){}
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs, UK2Node* InNode)
+	{
+		this->GraphNode = InNode;
+		this->SetCursor(EMouseCursor::CardinalCross);
+		this->UpdateGraphNode();
+	}
+
+protected:
+	virtual FSlateColor GetNodeBodyColor() const override
+	{
+		const TOptional<FLinearColor> HeatColor = NeatFunctionsProfiling::GetHeatColor(GraphNode);
+		return HeatColor.IsSet() ? FSlateColor(HeatColor.GetValue()) : SGraphNodeK2Default::GetNodeBodyColor();
+	}
+
+	virtual FText GetNodeTooltip() const override
+	{
+		return NeatFunctionsProfiling::AppendHeatTooltip(GraphNode, SGraphNodeK2Default::GetNodeTooltip());
+	}
+};
+
+TSharedPtr<SGraphNode> UK2Node_NeatConstructor::CreateVisualWidget()
+{
+	return SNew(SNeatConstructorNode, this);
+}
+
 bool UK2Node_NeatConstructor::CanJumpToDefinition() const
 {
 	return GetHelperCallFunctionNode(GetTargetFunction()).CanJumpToDefinition();
@@ -549,15 +929,37 @@ UFunction* UK2Node_NeatConstructor::GetFinishFunction() const
 	if (UFunction* FinishFunc = FinishFuncName ? TargetFunc->GetOwnerClass()->FindFunctionByName(FName(*FinishFuncName)) : nullptr)
 		return FinishFunc;
 
-	const FClassProperty* TargetFuncClass = CastField<FClassProperty>(TargetFunc->FindPropertyByName(NAME_Class));
+	const UClass* TargetFuncClass = GetClassParameterMetaClass(*TargetFunc);
 	if (!TargetFuncClass)
 		return nullptr;
 
-	if (TargetFuncClass->MetaClass->IsChildOf<AActor>())
+	if (TargetFuncClass->IsChildOf<AActor>())
 		return UNeatFunctionsStatics::StaticClass()->FindFunctionByName(GET_MEMBER_NAME_CHECKED(UNeatFunctionsStatics, DefaultFinishSpawningActor));
+
+	if (TargetFuncClass->IsChildOf<UActorComponent>() && TargetFunc->HasMetaData(NeatDeferredRegistrationMetadataName))
+		return UNeatFunctionsStatics::StaticClass()->FindFunctionByName(GET_MEMBER_NAME_CHECKED(UNeatFunctionsStatics, DeferredRegisterComponent));
 	return nullptr;
 }
 
+bool UK2Node_NeatConstructor::IsSoftClass() const
+{
+	const UFunction* Fn = GetTargetFunction();
+	return Fn && CastField<FSoftClassProperty>(Fn->FindPropertyByName(NAME_Class)) != nullptr;
+}
+
+UClass* UK2Node_NeatConstructor::GetSoftClassDefault(const TArray<UEdGraphPin*>* InPinsToSearch) const
+{
+	if (!IsSoftClass())
+		return nullptr;
+
+	const UEdGraphPin* ClassPin = GetClassPin(InPinsToSearch);
+	if (!ClassPin || ClassPin->LinkedTo.Num() > 0 || ClassPin->DefaultValue.IsEmpty())
+		return nullptr;
+
+	// Loading the class in the editor is fine. The Blueprint itself only stores the path.
+	return FSoftClassPath(ClassPin->DefaultValue).TryLoadClass<UObject>();
+}
+
 FName UK2Node_NeatConstructor::GetFinishFunctionObjectInputName() const
 {
 	const UClass* PinBase = GetClassPinBaseClass();
@@ -0,0 +1,338 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+#include "NeatFunctionIndex.h"
+
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "EdGraphSchema_K2.h"
+#include "K2Node.h"
+#include "K2Node_NeatBatchFunction.h"
+#include "K2Node_NeatCallFunction.h"
+#include "K2Node_NeatConstructor.h"
+#include "Kismet2/BlueprintEditorUtils.h"
+#include "Misc/PackageName.h"
+#include "UObject/MetaData.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogNeatFunctionIndex, Log, All);
+
+FNeatFunctionIndex& FNeatFunctionIndex::Get()
+{
+	static FNeatFunctionIndex Inst;
+	return Inst;
+}
+
+namespace
+{
+	// Asset registry tag of Blueprints, listing the Neat functions their nodes call as comma separated "Path=SignatureHash" pairs.
+	const FName NeatFunctionsTagName(TEXT("NeatFunctions"));
+}
+
+FNeatFunctionIndex::FNeatFunctionIndex()
+{
+	ReloadCompleteHandle = FCoreUObjectDelegates::ReloadCompleteDelegate.AddLambda([this](EReloadCompleteReason)
+	{
+		OnReloadComplete();
+	});
+	ExtraObjectTagsHandle = UObject::FAssetRegistryTag::OnGetExtraObjectTags.AddRaw(this, &FNeatFunctionIndex::GetBlueprintTags);
+
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	AssetAddedHandle = AssetRegistry.OnAssetAdded().AddRaw(this, &FNeatFunctionIndex::IndexAsset);
+	AssetUpdatedHandle = AssetRegistry.OnAssetUpdated().AddRaw(this, &FNeatFunctionIndex::IndexAsset);
+	AssetRemovedHandle = AssetRegistry.OnAssetRemoved().AddRaw(this, &FNeatFunctionIndex::OnAssetRemoved);
+	AssetRenamedHandle = AssetRegistry.OnAssetRenamed().AddRaw(this, &FNeatFunctionIndex::OnAssetRenamed);
+
+	if (AssetRegistry.IsLoadingAssets())
+	{
+		FilesLoadedHandle = AssetRegistry.OnFilesLoaded().AddRaw(this, &FNeatFunctionIndex::OnFilesLoaded);
+	}
+	else
+	{
+		OnFilesLoaded();
+	}
+}
+
+void FNeatFunctionIndex::Shutdown()
+{
+	FCoreUObjectDelegates::ReloadCompleteDelegate.Remove(ReloadCompleteHandle);
+	UObject::FAssetRegistryTag::OnGetExtraObjectTags.Remove(ExtraObjectTagsHandle);
+
+	// The asset registry may already have been unloaded.
+	if (FAssetRegistryModule* AssetRegistryModule = FModuleManager::GetModulePtr<FAssetRegistryModule>(TEXT("AssetRegistry")))
+	{
+		IAssetRegistry& AssetRegistry = AssetRegistryModule->Get();
+		AssetRegistry.OnAssetAdded().Remove(AssetAddedHandle);
+		AssetRegistry.OnAssetUpdated().Remove(AssetUpdatedHandle);
+		AssetRegistry.OnAssetRemoved().Remove(AssetRemovedHandle);
+		AssetRegistry.OnAssetRenamed().Remove(AssetRenamedHandle);
+		AssetRegistry.OnFilesLoaded().Remove(FilesLoadedHandle);
+	}
+
+	ReloadCompleteHandle.Reset();
+	ExtraObjectTagsHandle.Reset();
+	AssetAddedHandle.Reset();
+	AssetUpdatedHandle.Reset();
+	AssetRemovedHandle.Reset();
+	AssetRenamedHandle.Reset();
+	FilesLoadedHandle.Reset();
+}
+
+void FNeatFunctionIndex::Register(UK2Node* Node, const UFunction* Function)
+{
+	// Only native functions can change through a hot reload. Blueprint functions are handled by the regular dependency tracking.
+	if (!Node || !Function || !Function->IsNative())
+		return;
+
+	FEntry& Entry = Entries.FindOrAdd(Function->GetPathName());
+	Entry.Nodes.RemoveAllSwap([](const TWeakObjectPtr<UK2Node>& Existing) { return !Existing.IsValid(); });
+	if (Entry.Nodes.Num() == 0)
+	{
+		Entry.SignatureHash = GetSignatureHash(*Function);
+	}
+	Entry.Nodes.AddUnique(Node);
+}
+
+void FNeatFunctionIndex::OnReloadComplete()
+{
+	TSet<UBlueprint*> BlueprintsToRecompile;
+	int32 NumReconstructed = 0;
+
+	for (auto It = Entries.CreateIterator(); It; ++It)
+	{
+		FEntry& Entry = It.Value();
+		const UFunction* Function = FindObject<UFunction>(nullptr, *It.Key());
+		const uint32 SignatureHash = Function ? GetSignatureHash(*Function) : 0;
+		if (SignatureHash == Entry.SignatureHash)
+			continue;
+
+		Entry.SignatureHash = SignatureHash;
+
+		// Reconstructing a node registers it again, so iterate over a copy.
+		const TArray<TWeakObjectPtr<UK2Node>> Nodes = Entry.Nodes;
+		for (const TWeakObjectPtr<UK2Node>& WeakNode : Nodes)
+		{
+			UK2Node* Node = WeakNode.Get();
+			UBlueprint* Blueprint = Node ? FBlueprintEditorUtils::FindBlueprintForNode(Node) : nullptr;
+			if (!Blueprint)
+				continue;
+
+			Node->ReconstructNode();
+			BlueprintsToRecompile.Add(Blueprint);
+			NumReconstructed++;
+		}
+
+		if (!Function)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	for (UBlueprint* Blueprint : BlueprintsToRecompile)
+	{
+		FBlueprintEditorUtils::MarkBlueprintAsStructurallyModified(Blueprint);
+	}
+
+	if (NumReconstructed > 0)
+	{
+		UE_LOG(LogNeatFunctionIndex, Display, TEXT("Reconstructed %d Neat nodes in %d Blueprints after their functions changed."), NumReconstructed, BlueprintsToRecompile.Num());
+	}
+
+	ReportOutdatedUnloadedBlueprints();
+}
+
+void FNeatFunctionIndex::OnAssetRemoved(const FAssetData& AssetData)
+{
+	SavedSignatures.Remove(AssetData.PackageName);
+
+	// Nodes of deleted Blueprints can linger until the next garbage collection, and must not be reconstructed before then.
+	for (TPair<FString, FEntry>& Pair : Entries)
+	{
+		Pair.Value.Nodes.RemoveAllSwap([&AssetData](const TWeakObjectPtr<UK2Node>& Node)
+		{
+			return !Node.IsValid() || Node->GetPackage()->GetFName() == AssetData.PackageName;
+		});
+	}
+}
+
+void FNeatFunctionIndex::OnAssetRenamed(const FAssetData& AssetData, const FString& OldObjectPath)
+{
+	SavedSignatures.Remove(FName(*FPackageName::ObjectPathToPackageName(OldObjectPath)));
+	IndexAsset(AssetData);
+}
+
+void FNeatFunctionIndex::OnFilesLoaded()
+{
+	// Assets found by the initial scan are indexed in one go, instead of one OnAssetAdded at a time.
+	FARFilter Filter;
+	Filter.TagsAndValues.Add(NeatFunctionsTagName);
+
+	TArray<FAssetData> Assets;
+	IAssetRegistry::GetChecked().GetAssets(Filter, Assets);
+	for (const FAssetData& AssetData : Assets)
+	{
+		IndexAsset(AssetData);
+	}
+
+	// Catches functions that changed while the editor was closed.
+	ReportOutdatedUnloadedBlueprints();
+}
+
+void FNeatFunctionIndex::IndexAsset(const FAssetData& AssetData)
+{
+	if (IAssetRegistry::GetChecked().IsLoadingAssets())
+		return;
+
+	FString TagValue;
+	if (!AssetData.GetTagValue(NeatFunctionsTagName, TagValue))
+	{
+		SavedSignatures.Remove(AssetData.PackageName);
+		return;
+	}
+
+	TMap<FString, uint32>& Signatures = SavedSignatures.FindOrAdd(AssetData.PackageName);
+	Signatures.Reset();
+
+	TArray<FString> Pairs;
+	TagValue.ParseIntoArray(Pairs, TEXT(","));
+	for (const FString& Pair : Pairs)
+	{
+		FString Path;
+		FString Hash;
+		if (Pair.Split(TEXT("="), &Path, &Hash))
+		{
+			Signatures.Add(Path, static_cast<uint32>(FCString::Strtoui64(*Hash, nullptr, 10)));
+		}
+	}
+}
+
+void FNeatFunctionIndex::GetBlueprintTags(const UObject* Object, TArray<UObject::FAssetRegistryTag>& OutTags) const
+{
+	const UBlueprint* Blueprint = Cast<UBlueprint>(Object);
+	if (!Blueprint)
+		return;
+
+	TArray<FString> Pairs;
+	for (const TPair<FString, FEntry>& Pair : Entries)
+	{
+		const bool bIsCalledByBlueprint = Pair.Value.Nodes.ContainsByPredicate([Blueprint](const TWeakObjectPtr<UK2Node>& Node)
+		{
+			return Node.IsValid() && FBlueprintEditorUtils::FindBlueprintForNode(Node.Get()) == Blueprint;
+		});
+
+		if (bIsCalledByBlueprint)
+		{
+			Pairs.Add(FString::Printf(TEXT("%s=%u"), *Pair.Key, Pair.Value.SignatureHash));
+		}
+	}
+
+	if (Pairs.Num() > 0)
+	{
+		Pairs.Sort();
+		OutTags.Add(UObject::FAssetRegistryTag(NeatFunctionsTagName, FString::Join(Pairs, TEXT(",")), UObject::FAssetRegistryTag::TT_Hidden));
+	}
+}
+
+void FNeatFunctionIndex::ReportOutdatedUnloadedBlueprints() const
+{
+	// Loaded Blueprints are reconstructed instead. Unloaded ones are only listed, since they pick up the change when they are loaded.
+	TMap<FString, uint32> CurrentSignatures;
+	TArray<FString> OutdatedPackages;
+	for (const TPair<FName, TMap<FString, uint32>>& Package : SavedSignatures)
+	{
+		if (FindPackage(nullptr, *Package.Key.ToString()))
+			continue;
+
+		for (const TPair<FString, uint32>& Signature : Package.Value)
+		{
+			const uint32* CurrentSignature = CurrentSignatures.Find(Signature.Key);
+			if (!CurrentSignature)
+			{
+				const UFunction* Function = FindObject<UFunction>(nullptr, *Signature.Key);
+				CurrentSignature = &CurrentSignatures.Add(Signature.Key, Function ? GetSignatureHash(*Function) : 0);
+			}
+
+			if (*CurrentSignature != Signature.Value)
+			{
+				OutdatedPackages.Add(Package.Key.ToString());
+				break;
+			}
+		}
+	}
+
+	if (OutdatedPackages.Num() > 0)
+	{
+		OutdatedPackages.Sort();
+		UE_LOG(LogNeatFunctionIndex, Display, TEXT("%d unloaded Blueprints call Neat functions that changed since they were saved. Their nodes are reconstructed when they are loaded: %s"),
+			OutdatedPackages.Num(), *FString::Join(OutdatedPackages, TEXT(", ")));
+	}
+}
+
+bool FNeatFunctionIndex::IsPinMetaData(FName Key)
+{
+	static const TSet<FName> PinKeys =
+	{
+		UK2Node_NeatCallFunction::DelegateFunctionMetadataName,
+		UK2Node_NeatCallFunction::CoalesceMetadataName,
+		UK2Node_NeatCallFunction::PersistentMetadataName,
+		UK2Node_NeatConstructor::NeatConstructorMetadataName,
+		UK2Node_NeatConstructor::NeatConstructorFinishMetadataName,
+		UK2Node_NeatConstructor::NeatValidationMetadataName,
+		UK2Node_NeatConstructor::NeatSpawnPropertiesMetadataName,
+		UK2Node_NeatConstructor::NeatDeferredRegistrationMetadataName,
+		UK2Node_NeatConstructor::NeatClusteredMetadataName,
+		UK2Node_NeatBatchFunction::BatchFunctionMetadataName,
+		FBlueprintMetadata::MD_DefaultToSelf,
+		FBlueprintMetadata::MD_WorldContext,
+		FBlueprintMetadata::MD_CallableWithoutWorldContext,
+		FBlueprintMetadata::MD_Latent,
+		FBlueprintMetadata::MD_LatentInfo,
+		FBlueprintMetadata::MD_HidePin,
+		FBlueprintMetadata::MD_InternalUseParam,
+		FBlueprintMetadata::MD_AutoCreateRefTerm,
+		FBlueprintMetadata::MD_ExpandEnumAsExecs,
+		FBlueprintMetadata::MD_DeterminesOutputType,
+		FBlueprintMetadata::MD_DynamicOutputParam,
+		FBlueprintMetadata::MD_ArrayParam,
+		FBlueprintMetadata::MD_ArrayDependentParam,
+		FBlueprintMetadata::MD_CustomStructureParam,
+		FName(TEXT("AdvancedDisplay")),
+	};
+
+	// Default values of parameters are stored as one key per parameter.
+	return PinKeys.Contains(Key) || Key.ToString().StartsWith(TEXT("CPP_Default_"));
+}
+
+uint32 FNeatFunctionIndex::GetSignatureHash(const UFunction& Function)
+{
+	uint32 Hash = GetTypeHash(static_cast<uint32>(Function.FunctionFlags));
+
+	for (TFieldIterator<FProperty> PropIt(&Function); PropIt && PropIt->HasAnyPropertyFlags(CPF_Parm); ++PropIt)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(PropIt->GetFName()));
+		Hash = HashCombine(Hash, GetTypeHash(PropIt->GetCPPType()));
+		Hash = HashCombine(Hash, GetTypeHash(static_cast<uint64>(PropIt->PropertyFlags & CPF_ParmFlags)));
+
+		// The parameters of delegates become pins on Neat delegate function nodes.
+		if (const FDelegateProperty* DelegateProp = CastField<FDelegateProperty>(*PropIt))
+		{
+			Hash = HashCombine(Hash, GetSignatureHash(*DelegateProp->SignatureFunction));
+		}
+	}
+
+	// Metadata decides which pins Neat nodes create, and how they are expanded. Only keys written in the UFUNCTION declaration that matter for
+	// that are included. Others, like the BlueprintInternalUseOnly the editor module adds after startup, would make every function look changed.
+	if (const TMap<FName, FString>* MetaData = UMetaData::GetMapForObject(&Function))
+	{
+		TArray<TPair<FName, FString>> PinMetaData;
+		for (const TPair<FName, FString>& Pair : *MetaData)
+		{
+			if (IsPinMetaData(Pair.Key))
+				PinMetaData.Add(Pair);
+		}
+
+		// The order of the map depends on the order the keys were added in.
+		PinMetaData.Sort([](const TPair<FName, FString>& A, const TPair<FName, FString>& B) { return A.Key.LexicalLess(B.Key); });
+		for (const TPair<FName, FString>& Pair : PinMetaData)
+		{
+			Hash = HashCombine(Hash, HashCombine(GetTypeHash(Pair.Key.ToString()), GetTypeHash(Pair.Value)));
+		}
+	}
+	return Hash;
+}
@@ -0,0 +1,66 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+#pragma once
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+
+struct FAssetData;
+class UFunction;
+class UK2Node;
+
+/**
+ * Reverse index from native Neat functions to the loaded nodes that call them.
+ * After a hot reload or Live Coding patch, only nodes whose function signature actually changed are reconstructed,
+ * and only the Blueprints containing them are queued for recompilation.
+ * Blueprints that aren't loaded are indexed through an asset registry tag holding the signatures their nodes were saved with.
+ */
+class FNeatFunctionIndex
+{
+public:
+	static FNeatFunctionIndex& Get();
+
+	// Called by Neat nodes whenever they allocate their pins, which they do both when placed and when loaded.
+	void Register(UK2Node* Node, const UFunction* Function);
+
+	// Removes the delegates bound by the index. Called when the module shuts down.
+	void Shutdown();
+
+private:
+	FNeatFunctionIndex();
+
+	void OnReloadComplete();
+	void OnAssetRemoved(const FAssetData& AssetData);
+	void OnAssetRenamed(const FAssetData& AssetData, const FString& OldObjectPath);
+	void OnFilesLoaded();
+
+	// Replaces the signatures indexed for the package of the asset with the ones stored in its tag.
+	void IndexAsset(const FAssetData& AssetData);
+
+	// Adds the tag listing the Neat functions a Blueprint calls, when it's saved.
+	void GetBlueprintTags(const UObject* Object, TArray<UObject::FAssetRegistryTag>& OutTags) const;
+
+	// Logs the unloaded Blueprints whose Neat nodes were saved with a signature that no longer matches the function.
+	void ReportOutdatedUnloadedBlueprints() const;
+
+	static bool IsPinMetaData(FName Key);
+	static uint32 GetSignatureHash(const UFunction& Function);
+
+	struct FEntry
+	{
+		uint32 SignatureHash = 0;
+		TArray<TWeakObjectPtr<UK2Node>> Nodes;
+	};
+
+	// Keyed by the path of the function, since reinstancing may replace the class that owns the function.
+	TMap<FString, FEntry> Entries;
+
+	// Signature hash of each Neat function, keyed by its path, that the nodes of a Blueprint package were saved with.
+	TMap<FName, TMap<FString, uint32>> SavedSignatures;
+
+	FDelegateHandle ReloadCompleteHandle;
+	FDelegateHandle ExtraObjectTagsHandle;
+	FDelegateHandle AssetAddedHandle;
+	FDelegateHandle AssetUpdatedHandle;
+	FDelegateHandle AssetRemovedHandle;
+	FDelegateHandle AssetRenamedHandle;
+	FDelegateHandle FilesLoadedHandle;
+};
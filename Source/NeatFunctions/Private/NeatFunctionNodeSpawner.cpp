@@ -0,0 +1,46 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+#include "NeatFunctionNodeSpawner.h"
+#include "K2Node_CallFunction.h"
+#include "UObject/Package.h"
+
+UNeatFunctionNodeSpawner* UNeatFunctionNodeSpawner::Create(TSubclassOf<UK2Node> NodeClass, const UFunction* Function, FGetIcon InGetIcon)
+{
+	UNeatFunctionNodeSpawner* NodeSpawner = NewObject<UNeatFunctionNodeSpawner>(GetTransientPackage());
+	NodeSpawner->NodeClass = NodeClass;
+	NodeSpawner->SetField(const_cast<UFunction*>(Function));
+	NodeSpawner->GetIcon = MoveTemp(InGetIcon);
+	return NodeSpawner;
+}
+
+void UNeatFunctionNodeSpawner::Prime()
+{
+	// The base class allocates the pins of a template node and fills in the default menu entry here, which is exactly what this spawner avoids.
+	// The menu entry is built by GetUiSpec instead, the first time it's shown.
+}
+
+FBlueprintActionUiSpec UNeatFunctionNodeSpawner::GetUiSpec(FBlueprintActionContext const& Context, FBindingSet const& Bindings) const
+{
+	const UFunction* Function = GetField().Get<UFunction>();
+	if (!Function)
+		return Super::GetUiSpec(Context, Bindings);
+
+	if (!UiSpec.IsSet())
+	{
+		// Everything the base class would otherwise get from a template node is filled in here, so no template node has to be spawned either.
+		FBlueprintActionUiSpec& MenuSignature = UiSpec.Emplace();
+		MenuSignature.MenuName = UK2Node_CallFunction::GetUserFacingFunctionName(Function);
+		MenuSignature.Category = UK2Node_CallFunction::GetDefaultCategoryForFunction(Function, FText::GetEmpty());
+		MenuSignature.Tooltip = FText::FromString(UK2Node_CallFunction::GetDefaultTooltipForFunction(Function));
+		MenuSignature.Keywords = UK2Node_CallFunction::GetKeywordsForFunction(Function);
+
+		if (GetIcon)
+		{
+			MenuSignature.Icon = GetIcon(*Function);
+			MenuSignature.IconTint = FLinearColor::White;
+		}
+	}
+
+	FBlueprintActionUiSpec MenuSignature = UiSpec.GetValue();
+	DynamicUiSignatureGetter.ExecuteIfBound(Context, Bindings, &MenuSignature);
+	return MenuSignature;
+}
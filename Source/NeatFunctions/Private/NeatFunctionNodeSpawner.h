@@ -0,0 +1,29 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+#pragma once
+#include "CoreMinimal.h"
+#include "BlueprintFieldNodeSpawner.h"
+#include "NeatFunctionNodeSpawner.generated.h"
+
+/**
+ * Spawner for Neat nodes that only builds its menu entry (name, category, tooltip and keywords) the first time the entry is shown.
+ * Most spawners are never displayed, so this saves both the time and the memory of building entries for every Neat function up front.
+ */
+UCLASS(Transient)
+class UNeatFunctionNodeSpawner : public UBlueprintFieldNodeSpawner
+{
+	GENERATED_BODY()
+
+public:
+	using FGetIcon = TFunction<FSlateIcon(const UFunction&)>;
+
+	static UNeatFunctionNodeSpawner* Create(TSubclassOf<UK2Node> NodeClass, const UFunction* Function, FGetIcon InGetIcon);
+
+	virtual void Prime() override;
+	virtual FBlueprintActionUiSpec GetUiSpec(FBlueprintActionContext const& Context, FBindingSet const& Bindings) const override;
+
+private:
+	FGetIcon GetIcon;
+
+	// Built by the first call to GetUiSpec.
+	mutable TOptional<FBlueprintActionUiSpec> UiSpec;
+};
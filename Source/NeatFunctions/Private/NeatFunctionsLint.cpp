@@ -0,0 +1,168 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+#include "NeatFunctionsLint.h"
+
+#include "EdGraphSchema_K2.h"
+#include "K2Node_Event.h"
+#include "K2Node_MacroInstance.h"
+#include "K2Node_Self.h"
+#include "K2Node_VariableGet.h"
+#include "Kismet2/CompilerResultsLog.h"
+
+namespace
+{
+	// Native loop nodes name the exec output of their body like this. The StandardMacros loops are recognized by their graph instead.
+	const FName LoopBodyPinName(TEXT("LoopBody"));
+	const FName LoopCompletedPinName(TEXT("Completed"));
+
+	// Whether the execution wires inside the macro form a cycle, which is what makes ForLoop, ForEachLoop, WhileLoop and friends loop.
+	bool HasExecCycle(const UEdGraph& MacroGraph)
+	{
+		enum class EVisitState : uint8 { InProgress, Done };
+		TMap<const UEdGraphNode*, EVisitState> States;
+
+		TFunction<bool(const UEdGraphNode*)> Visit = [&](const UEdGraphNode* Node)
+		{
+			if (const EVisitState* State = States.Find(Node))
+				return *State == EVisitState::InProgress;
+
+			States.Add(Node, EVisitState::InProgress);
+			for (const UEdGraphPin* Pin : Node->Pins)
+			{
+				if (Pin->Direction != EGPD_Output || Pin->PinType.PinCategory != UEdGraphSchema_K2::PC_Exec)
+					continue;
+
+				for (const UEdGraphPin* LinkedPin : Pin->LinkedTo)
+				{
+					if (Visit(LinkedPin->GetOwningNode()))
+						return true;
+				}
+			}
+			States.Add(Node, EVisitState::Done);
+			return false;
+		};
+
+		for (const UEdGraphNode* Node : MacroGraph.Nodes)
+		{
+			if (Node && Visit(Node))
+				return true;
+		}
+		return false;
+	}
+
+	// HasExecCycle walks the whole macro, and every Neat node in a graph asks about the same few loop macros, so the answer is kept per macro graph.
+	// Editing a macro modifies the graph or its nodes, which drops its entry.
+	TMap<TObjectKey<UEdGraph>, bool> ExecCycleCache;
+
+	bool HasExecCycleCached(const UEdGraph& MacroGraph)
+	{
+		static const bool bInvalidationRegistered = []()
+		{
+			FCoreUObjectDelegates::OnObjectModified.AddLambda([](UObject* Object)
+			{
+				const UEdGraphNode* Node = Cast<UEdGraphNode>(Object);
+				if (const UEdGraph* Graph = Node ? Node->GetGraph() : Cast<UEdGraph>(Object))
+				{
+					ExecCycleCache.Remove(Graph);
+				}
+			});
+			return true;
+		}();
+
+		if (const bool* bHasCycle = ExecCycleCache.Find(&MacroGraph))
+			return *bHasCycle;
+
+		return ExecCycleCache.Add(&MacroGraph, HasExecCycle(MacroGraph));
+	}
+
+	bool IsLoopBodyPin(const UEdGraphPin& Pin)
+	{
+		if (Pin.PinName == LoopBodyPinName)
+			return true;
+
+		const UK2Node_MacroInstance* MacroInstance = Cast<UK2Node_MacroInstance>(Pin.GetOwningNode());
+		const UEdGraph* MacroGraph = MacroInstance ? MacroInstance->GetMacroGraph() : nullptr;
+		return MacroGraph && Pin.PinName != LoopCompletedPinName && HasExecCycleCached(*MacroGraph);
+	}
+
+	// Stop walking eventually in very large graphs, the check is only a hint.
+	constexpr int32 MaxNodesToVisit = 2048;
+
+	bool IsTickEvent(const UK2Node_Event& Event)
+	{
+		const FName EventName = Event.EventReference.GetMemberName();
+		return EventName == TEXT("ReceiveTick") || EventName == TEXT("Tick");
+	}
+}
+
+void NeatFunctionsLint::Report(FCompilerResultsLog& MessageLog, ENeatLintSeverity Severity, const FString& Message, const UEdGraphNode* Node)
+{
+	switch (Severity)
+	{
+	case ENeatLintSeverity::Note:
+		MessageLog.Note(*Message, Node);
+		break;
+	case ENeatLintSeverity::Warning:
+		MessageLog.Warning(*Message, Node);
+		break;
+	case ENeatLintSeverity::Error:
+		MessageLog.Error(*Message, Node);
+		break;
+	default:
+		break;
+	}
+}
+
+bool NeatFunctionsLint::IsReachableFromTickOrLoop(const UEdGraphNode* Node, FString& OutSource)
+{
+	TArray<const UEdGraphNode*> ToVisit = { Node };
+	TSet<const UEdGraphNode*> Visited = { Node };
+
+	while (ToVisit.Num() > 0 && Visited.Num() < MaxNodesToVisit)
+	{
+		const UEdGraphNode* Current = ToVisit.Pop();
+
+		if (const UK2Node_Event* Event = Cast<UK2Node_Event>(Current))
+		{
+			if (IsTickEvent(*Event))
+			{
+				OutSource = Event->GetNodeTitle(ENodeTitleType::ListView).ToString();
+				return true;
+			}
+			continue;
+		}
+
+		for (const UEdGraphPin* Pin : Current->Pins)
+		{
+			if (Pin->Direction != EGPD_Input || Pin->PinType.PinCategory != UEdGraphSchema_K2::PC_Exec)
+				continue;
+
+			for (const UEdGraphPin* LinkedPin : Pin->LinkedTo)
+			{
+				const UEdGraphNode* LinkedNode = LinkedPin->GetOwningNode();
+				if (IsLoopBodyPin(*LinkedPin))
+				{
+					OutSource = FString::Printf(TEXT("the loop body of %s"), *LinkedNode->GetNodeTitle(ENodeTitleType::ListView).ToString());
+					return true;
+				}
+
+				bool bAlreadyVisited = false;
+				Visited.Add(LinkedNode, &bAlreadyVisited);
+				if (!bAlreadyVisited)
+					ToVisit.Add(LinkedNode);
+			}
+		}
+	}
+
+	return false;
+}
+
+bool NeatFunctionsLint::IsLinkedToPureChain(const UEdGraphPin* Pin)
+{
+	for (const UEdGraphPin* LinkedPin : Pin->LinkedTo)
+	{
+		const UK2Node* LinkedNode = Cast<UK2Node>(LinkedPin->GetOwningNode());
+		if (LinkedNode && LinkedNode->IsNodePure() && !LinkedNode->IsA<UK2Node_VariableGet>() && !LinkedNode->IsA<UK2Node_Self>())
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,23 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+#pragma once
+#include "CoreMinimal.h"
+#include "NeatFunctionsSettings.h"
+
+class FCompilerResultsLog;
+class UEdGraphNode;
+class UEdGraphPin;
+
+/**
+ * Helpers for the compile-time performance checks of Neat nodes. Severities and thresholds come from UNeatFunctionsSettings.
+ */
+namespace NeatFunctionsLint
+{
+	// Logs Message (which should reference the node with "@@") at the given severity.
+	void Report(FCompilerResultsLog& MessageLog, ENeatLintSeverity Severity, const FString& Message, const UEdGraphNode* Node);
+
+	// Walks the execution wires backwards from Node, looking for a Tick event or the body of a loop. OutSource describes what was found.
+	bool IsReachableFromTickOrLoop(const UEdGraphNode* Node, FString& OutSource);
+
+	// Whether the pin is connected to a pure node that computes something, rather than just reading a variable.
+	bool IsLinkedToPureChain(const UEdGraphPin* Pin);
+}
@@ -1,14 +1,61 @@
 ﻿// Copyright Viktor Pramberg. All Rights Reserved.
 #include "K2Node_NeatCallFunction.h"
 #include "K2Node_NeatConstructor.h"
+#include "NeatFunctionIndex.h"
+#include "NeatFunctionsRuntimeSettings.h"
 #include "NeatFunctionsStyle.h"
+#include "NeatMemoizer.h"
+#include "GameDelegates.h"
 #include "Modules/ModuleManager.h"
 
+DEFINE_LOG_CATEGORY_STATIC(LogNeatFunctions, Log, All);
+
 class FNeatFunctionsModule : public IModuleInterface
 {
+	FDelegateHandle ModifyCookHandle;
+
+	// Setters of the native properties that end up in packaged builds.
+	static TMap<FString, FName> FindPropertySetters()
+	{
+		TMap<FString, FName> Setters;
+		for (const UClass* Class : TObjectRange<UClass>())
+		{
+			// Only native properties can have a BlueprintSetter. Editor modules don't exist in packaged builds.
+			if (!Class->HasAnyClassFlags(CLASS_Native) || Class->GetPackage()->HasAnyPackageFlags(PKG_EditorOnly | PKG_UncookedOnly))
+				continue;
+
+			for (TFieldIterator<FProperty> PropIt(Class, EFieldIteratorFlags::ExcludeSuper); PropIt; ++PropIt)
+			{
+				const FString& SetterName = PropIt->GetMetaData(TEXT("BlueprintSetter"));
+				if (!SetterName.IsEmpty())
+				{
+					Setters.Add(PropIt->GetPathName(), FName(*SetterName));
+				}
+			}
+		}
+		Setters.KeySort(TLess<FString>());
+		return Setters;
+	}
+
+	// Metadata is stripped from packaged builds, so the property setters are stored in the runtime settings.
+	// They are gathered when cooking, which is the only time packaged builds can pick them up, instead of relying on anyone to refresh them by hand.
+	static void UpdateRuntimeSettingsForCook(TArray<FName>& PackagesToCook, TArray<FName>& PackagesToNeverCook)
+	{
+		UNeatFunctionsRuntimeSettings* RuntimeSettings = GetMutableDefault<UNeatFunctionsRuntimeSettings>();
+		TMap<FString, FName> PropertySetters = FindPropertySetters();
+		if (!RuntimeSettings->PropertySetters.OrderIndependentCompareEqual(PropertySetters))
+		{
+			RuntimeSettings->PropertySetters = MoveTemp(PropertySetters);
+			RuntimeSettings->TryUpdateDefaultConfigFile();
+		}
+	}
+
 	virtual void StartupModule() override
 	{
 		FNeatFunctionsStyle::Get();
+		FNeatFunctionIndex::Get();
+
+		ModifyCookHandle = FGameDelegates::Get().GetModifyCookDelegate().AddStatic(&UpdateRuntimeSettingsForCook);
 
 		FCoreDelegates::OnPostEngineInit.AddLambda([]()
 		{
@@ -16,7 +63,7 @@ class FNeatFunctionsModule : public IModuleInterface
 			{
 				if (!Fn)
 					continue;
-				
+
 				if (Fn->HasMetaData(UK2Node_NeatCallFunction::DelegateFunctionMetadataName) ||
 					Fn->HasMetaData(UK2Node_NeatConstructor::NeatConstructorMetadataName) ||
 					Fn->HasMetaData(UK2Node_NeatConstructor::NeatConstructorFinishMetadataName))
@@ -24,9 +71,23 @@ class FNeatFunctionsModule : public IModuleInterface
 					Fn->SetMetaData(FBlueprintMetadata::MD_BlueprintInternalUseOnly, TEXT("true"));
 				}
 			}
+
+			// Metadata is stripped from packaged builds, so the memoized functions are stored in the runtime settings.
+			// Writing the config file is left to the settings, so starting the editor or a commandlet never modifies it.
+			if (GetDefault<UNeatFunctionsRuntimeSettings>()->MemoizedFunctions != FNeatMemoizer::FindTaggedFunctionPaths())
+			{
+				UE_LOG(LogNeatFunctions, Warning, TEXT("The memoized functions in the Neat Functions Runtime settings are out of date, so packaged builds won't memoize the right functions. "
+					"Press Refresh Memoized Functions in Project Settings > Plugins > Neat Functions Runtime to update them."));
+			}
 		});
 		
 	}
+
+	virtual void ShutdownModule() override
+	{
+		FGameDelegates::Get().GetModifyCookDelegate().Remove(ModifyCookHandle);
+		FNeatFunctionIndex::Get().Shutdown();
+	}
 };
 
 IMPLEMENT_MODULE(FNeatFunctionsModule, NeatFunctions)
\ No newline at end of file
@@ -0,0 +1,99 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+#include "NeatFunctionsProfiling.h"
+#include "NeatFunctionsProfiler.h"
+#include "NeatFunctionsStatics.h"
+
+#include "K2Node_CallFunction.h"
+#include "KismetCompiler.h"
+
+namespace
+{
+	TAutoConsoleVariable<bool> CVarInstrumentNodes(
+		TEXT("NeatFunctions.InstrumentNodes"),
+		false,
+		TEXT("When enabled, Neat nodes compiled from now on report their call counts and timings to the Neat profiler. Recompile Blueprints after changing this."));
+
+	TAutoConsoleVariable<bool> CVarRecordNodes(
+		TEXT("NeatFunctions.RecordNodes"),
+		false,
+		TEXT("When enabled, Neat nodes compiled from now on report delegate fires and constructions to the Neat recorder. Also applies when cooking. Recompile Blueprints after changing this."));
+
+	UK2Node_CallFunction* SpawnSampleNode(FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph, UK2Node* SourceNode, FName FunctionName)
+	{
+		UK2Node_CallFunction* SampleFunc = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(SourceNode, SourceGraph);
+		SampleFunc->SetFromFunction(UNeatFunctionsStatics::StaticClass()->FindFunctionByName(FunctionName));
+		SampleFunc->AllocateDefaultPins();
+		SampleFunc->FindPinChecked(TEXT("NodeGuid"))->DefaultValue = SourceNode->NodeGuid.ToString();
+		return SampleFunc;
+	}
+
+	UEdGraphPin* AppendCall(FKismetCompilerContext& CompilerContext, UK2Node_CallFunction& CallFunc, UEdGraphPin& ThenPin)
+	{
+		CompilerContext.MovePinLinksToIntermediate(ThenPin, *CallFunc.GetThenPin());
+		ThenPin.MakeLinkTo(CallFunc.GetExecPin());
+		return CallFunc.GetThenPin();
+	}
+}
+
+bool NeatFunctionsProfiling::ShouldInstrumentNodes()
+{
+	return CVarInstrumentNodes.GetValueOnGameThread() && !IsRunningCommandlet();
+}
+
+void NeatFunctionsProfiling::InsertBeginSample(FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph, UK2Node* SourceNode, UEdGraphPin& ExecPin)
+{
+	UK2Node_CallFunction* BeginFunc = SpawnSampleNode(CompilerContext, SourceGraph, SourceNode, GET_MEMBER_NAME_CHECKED(UNeatFunctionsStatics, NeatProfilerBeginSample));
+	CompilerContext.MovePinLinksToIntermediate(ExecPin, *BeginFunc->GetExecPin());
+	BeginFunc->GetThenPin()->MakeLinkTo(&ExecPin);
+}
+
+UEdGraphPin* NeatFunctionsProfiling::AppendEndSample(FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph, UK2Node* SourceNode, UEdGraphPin& ThenPin)
+{
+	UK2Node_CallFunction* EndFunc = SpawnSampleNode(CompilerContext, SourceGraph, SourceNode, GET_MEMBER_NAME_CHECKED(UNeatFunctionsStatics, NeatProfilerEndSample));
+	return AppendCall(CompilerContext, *EndFunc, ThenPin);
+}
+
+bool NeatFunctionsProfiling::ShouldRecordNodes()
+{
+	return CVarRecordNodes.GetValueOnGameThread();
+}
+
+UEdGraphPin* NeatFunctionsProfiling::AppendRecordConstruction(FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph, UK2Node* SourceNode, UEdGraphPin& ThenPin, const UFunction* Function, UEdGraphPin& ObjectPin)
+{
+	UK2Node_CallFunction* RecordFunc = SpawnSampleNode(CompilerContext, SourceGraph, SourceNode, GET_MEMBER_NAME_CHECKED(UNeatFunctionsStatics, NeatRecordConstruction));
+	RecordFunc->FindPinChecked(TEXT("Function"))->DefaultValue = Function->GetPathName();
+	ObjectPin.MakeLinkTo(RecordFunc->FindPinChecked(TEXT("Object")));
+	return AppendCall(CompilerContext, *RecordFunc, ThenPin);
+}
+
+UEdGraphPin* NeatFunctionsProfiling::AppendRecordDelegateFire(FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph, UK2Node* SourceNode, UEdGraphPin& ThenPin, const UFunction* Function, int32 PayloadSize)
+{
+	UK2Node_CallFunction* RecordFunc = SpawnSampleNode(CompilerContext, SourceGraph, SourceNode, GET_MEMBER_NAME_CHECKED(UNeatFunctionsStatics, NeatRecordDelegateFire));
+	RecordFunc->FindPinChecked(TEXT("Function"))->DefaultValue = Function->GetPathName();
+	RecordFunc->FindPinChecked(TEXT("PayloadSize"))->DefaultValue = FString::FromInt(PayloadSize);
+	return AppendCall(CompilerContext, *RecordFunc, ThenPin);
+}
+
+TOptional<FLinearColor> NeatFunctionsProfiling::GetHeatColor(const UEdGraphNode* Node)
+{
+	const FNeatFunctionsProfiler& Profiler = FNeatFunctionsProfiler::Get();
+	const FNeatNodeStats* Stats = Node ? Profiler.FindStats(Node->NodeGuid) : nullptr;
+	if (!Stats || Profiler.GetMaxTotalSeconds() <= 0.0)
+		return {};
+
+	const float Heat = static_cast<float>(Stats->TotalSeconds / Profiler.GetMaxTotalSeconds());
+	return FLinearColor::LerpUsingHSV(FLinearColor(0.2f, 0.8f, 0.2f), FLinearColor(1.0f, 0.1f, 0.1f), Heat);
+}
+
+FText NeatFunctionsProfiling::AppendHeatTooltip(const UEdGraphNode* Node, const FText& Tooltip)
+{
+	const FNeatNodeStats* Stats = Node ? FNeatFunctionsProfiler::Get().FindStats(Node->NodeGuid) : nullptr;
+	if (!Stats)
+		return Tooltip;
+
+	return FText::Format(INVTEXT("{0}\n\nCalls per frame: {1}\nAverage: {2} us\nTotal calls: {3}"),
+		Tooltip,
+		FText::AsNumber(Stats->GetCallsPerFrame()),
+		FText::AsNumber(Stats->GetAverageMicroseconds()),
+		FText::AsNumber(Stats->CallCount));
+}
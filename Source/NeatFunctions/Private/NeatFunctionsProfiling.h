@@ -0,0 +1,40 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+#pragma once
+#include "CoreMinimal.h"
+
+class FKismetCompilerContext;
+class UEdGraph;
+class UEdGraphNode;
+class UEdGraphPin;
+class UFunction;
+class UK2Node;
+
+/**
+ * Compile-time instrumentation of Neat nodes, and the heatmap overlay that displays the samples collected by FNeatFunctionsProfiler.
+ */
+namespace NeatFunctionsProfiling
+{
+	// Whether nodes compiled right now should call into the profiler. Never true when cooking, so shipped bytecode never pays for sampling.
+	bool ShouldInstrumentNodes();
+
+	// Inserts a sample start in front of ExecPin, taking over all of its incoming links.
+	void InsertBeginSample(FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph, UK2Node* SourceNode, UEdGraphPin& ExecPin);
+
+	// Appends a sample end after ThenPin. Returns the Then pin of the new node, which takes over all outgoing links of ThenPin.
+	UEdGraphPin* AppendEndSample(FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph, UK2Node* SourceNode, UEdGraphPin& ThenPin);
+
+	// Whether nodes compiled right now should report to FNeatRecorder. Unlike instrumentation for the profiler, this is also respected when cooking.
+	bool ShouldRecordNodes();
+
+	// Appends a record of a construction after ThenPin. Returns the Then pin of the new node, which takes over all outgoing links of ThenPin.
+	UEdGraphPin* AppendRecordConstruction(FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph, UK2Node* SourceNode, UEdGraphPin& ThenPin, const UFunction* Function, UEdGraphPin& ObjectPin);
+
+	// Appends a record of a delegate fire after ThenPin. Returns the Then pin of the new node, which takes over all outgoing links of ThenPin.
+	UEdGraphPin* AppendRecordDelegateFire(FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph, UK2Node* SourceNode, UEdGraphPin& ThenPin, const UFunction* Function, int32 PayloadSize);
+
+	// Tint for the node body based on how much of the total sampled time was spent in this node, or unset if there are no samples.
+	TOptional<FLinearColor> GetHeatColor(const UEdGraphNode* Node);
+
+	// Appends calls per frame and average time to the tooltip of a node, if there are samples for it.
+	FText AppendHeatTooltip(const UEdGraphNode* Node, const FText& Tooltip);
+}
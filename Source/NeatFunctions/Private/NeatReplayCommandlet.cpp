@@ -0,0 +1,200 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#include "NeatReplayCommandlet.h"
+#include "NeatRecorder.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "Misc/FileHelper.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogNeatReplay, Log, All);
+
+namespace
+{
+	struct FReplayFrame
+	{
+		uint64 Frame = 0;
+		int32 NumConstructions = 0;
+		int32 NumDelegateFires = 0;
+		double Seconds = 0.0;
+	};
+
+	// Fills in the parameters of a NeatConstructor function the same way for every call, with the recorded class and the replay world or owner for object parameters.
+	bool ReplayConstruction(UWorld& World, AActor& Owner, UFunction& Function, UClass& Class)
+	{
+		UObject* Context = Function.HasAnyFunctionFlags(FUNC_Static) ? Function.GetOwnerClass()->GetDefaultObject() : &Owner;
+		if (!Context->IsA(Function.GetOwnerClass()))
+			return false;
+
+		uint8* Parms = static_cast<uint8*>(FMemory_Alloca_Aligned(Function.ParmsSize, Function.GetMinAlignment()));
+		FMemory::Memzero(Parms, Function.ParmsSize);
+
+		FObjectPropertyBase* ReturnParam = nullptr;
+		for (TFieldIterator<FProperty> PropIt(&Function); PropIt && PropIt->HasAnyPropertyFlags(CPF_Parm); ++PropIt)
+		{
+			FProperty* Param = *PropIt;
+			Param->InitializeValue_InContainer(Parms);
+
+			if (Param->HasAnyPropertyFlags(CPF_ReturnParm))
+			{
+				ReturnParam = CastField<FObjectPropertyBase>(Param);
+			}
+			else if (const FClassProperty* ClassParam = CastField<FClassProperty>(Param))
+			{
+				if (Class.IsChildOf(ClassParam->MetaClass))
+					ClassParam->SetObjectPropertyValue_InContainer(Parms, &Class);
+			}
+			else if (const FSoftClassProperty* SoftClassParam = CastField<FSoftClassProperty>(Param))
+			{
+				if (Class.IsChildOf(SoftClassParam->MetaClass))
+					SoftClassParam->SetPropertyValue_InContainer(Parms, FSoftObjectPtr(&Class));
+			}
+			else if (const FObjectProperty* ObjectParam = CastField<FObjectProperty>(Param))
+			{
+				if (Owner.IsA(ObjectParam->PropertyClass))
+					ObjectParam->SetObjectPropertyValue_InContainer(Parms, &Owner);
+				else if (World.IsA(ObjectParam->PropertyClass))
+					ObjectParam->SetObjectPropertyValue_InContainer(Parms, &World);
+			}
+		}
+
+		Context->ProcessEvent(&Function, Parms);
+
+		// Actors are usually spawned deferred by NeatConstructors, and finished by the finish function of the node.
+		AActor* SpawnedActor = ReturnParam ? Cast<AActor>(ReturnParam->GetObjectPropertyValue_InContainer(Parms)) : nullptr;
+		if (SpawnedActor && !SpawnedActor->IsActorInitialized())
+		{
+			SpawnedActor->FinishSpawning(SpawnedActor->GetTransform(), true);
+		}
+
+		for (TFieldIterator<FProperty> PropIt(&Function); PropIt && PropIt->HasAnyPropertyFlags(CPF_Parm); ++PropIt)
+		{
+			PropIt->DestroyValue_InContainer(Parms);
+		}
+		return true;
+	}
+}
+
+UNeatReplayCommandlet::UNeatReplayCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UNeatReplayCommandlet::Main(const FString& Params)
+{
+	FString CaptureFilename;
+	if (!FParse::Value(*Params, TEXT("Capture="), CaptureFilename))
+	{
+		UE_LOG(LogNeatReplay, Error, TEXT("Usage: -run=NeatReplay -Capture=<Filename> [-Report=<Filename>]"));
+		return 1;
+	}
+
+	TArray<FNeatRecord> Records;
+	TArray<FString> Names;
+	if (!FNeatRecorder::ReadCapture(CaptureFilename, Records, Names))
+		return 1;
+
+	UE_LOG(LogNeatReplay, Display, TEXT("Replaying %d Neat events from %s."), Records.Num(), *CaptureFilename);
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("NeatReplay"));
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+
+	AActor* Owner = World->SpawnActor<AActor>();
+
+	TMap<int32, UObject*> ResolvedNames;
+	const auto Resolve = [&](int32 Index, UClass* Type) -> UObject*
+	{
+		if (!Names.IsValidIndex(Index))
+			return nullptr;
+
+		if (UObject* const* Resolved = ResolvedNames.Find(Index))
+			return *Resolved;
+
+		UObject* Object = StaticLoadObject(Type, nullptr, *Names[Index]);
+		if (!Object)
+		{
+			UE_LOG(LogNeatReplay, Warning, TEXT("Failed to resolve %s. Events using it are skipped."), *Names[Index]);
+		}
+		return ResolvedNames.Add(Index, Object);
+	};
+
+	TArray<FReplayFrame> Frames;
+	int32 NumSkipped = 0;
+	uint64 TotalPayloadBytes = 0;
+	double PreviousTimestamp = Records.Num() > 0 ? Records[0].Timestamp : 0.0;
+
+	for (const FNeatRecord& Record : Records)
+	{
+		if (Frames.Num() == 0 || Frames.Last().Frame != Record.Frame)
+		{
+			// Advance the world by the recorded time between frames, so timers and latent actions behave as they did.
+			if (Frames.Num() > 0)
+			{
+				const float DeltaSeconds = FMath::Clamp(static_cast<float>(Record.Timestamp - PreviousTimestamp), 0.0f, 0.1f);
+				World->Tick(LEVELTICK_All, DeltaSeconds);
+			}
+			Frames.AddDefaulted_GetRef().Frame = Record.Frame;
+			PreviousTimestamp = Record.Timestamp;
+		}
+
+		FReplayFrame& Frame = Frames.Last();
+		if (Record.Type == ENeatRecordType::DelegateFire)
+		{
+			Frame.NumDelegateFires++;
+			TotalPayloadBytes += Record.PayloadSize;
+			continue;
+		}
+
+		UFunction* Function = Cast<UFunction>(Resolve(Record.FunctionIndex, UFunction::StaticClass()));
+		UClass* Class = Cast<UClass>(Resolve(Record.ClassIndex, UClass::StaticClass()));
+
+		const double StartTime = FPlatformTime::Seconds();
+		if (Function && Class && ReplayConstruction(*World, *Owner, *Function, *Class))
+		{
+			Frame.Seconds += FPlatformTime::Seconds() - StartTime;
+			Frame.NumConstructions++;
+		}
+		else
+		{
+			NumSkipped++;
+		}
+	}
+
+	double TotalSeconds = 0.0;
+	for (const FReplayFrame& Frame : Frames)
+	{
+		TotalSeconds += Frame.Seconds;
+	}
+
+	TArray<FReplayFrame> SlowestFrames = Frames;
+	SlowestFrames.Sort([](const FReplayFrame& A, const FReplayFrame& B) { return A.Seconds > B.Seconds; });
+
+	UE_LOG(LogNeatReplay, Display, TEXT("Replayed %d frames in %.2f ms. %d constructions were skipped, %llu bytes of delegate payloads were recorded."),
+		Frames.Num(), TotalSeconds * 1000.0, NumSkipped, TotalPayloadBytes);
+	for (int32 Index = 0; Index < FMath::Min(SlowestFrames.Num(), 10); ++Index)
+	{
+		const FReplayFrame& Frame = SlowestFrames[Index];
+		UE_LOG(LogNeatReplay, Display, TEXT("  Frame %llu: %.3f ms, %d constructions, %d delegate fires."), Frame.Frame, Frame.Seconds * 1000.0, Frame.NumConstructions, Frame.NumDelegateFires);
+	}
+
+	FString ReportFilename;
+	if (FParse::Value(*Params, TEXT("Report="), ReportFilename))
+	{
+		FString Report = TEXT("Frame,Milliseconds,Constructions,DelegateFires\n");
+		for (const FReplayFrame& Frame : Frames)
+		{
+			Report += FString::Printf(TEXT("%llu,%.4f,%d,%d\n"), Frame.Frame, Frame.Seconds * 1000.0, Frame.NumConstructions, Frame.NumDelegateFires);
+		}
+		FFileHelper::SaveStringToFile(Report, *ReportFilename);
+	}
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	return 0;
+}
@@ -0,0 +1,42 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+#pragma once
+#include "K2Node_CallFunction.h"
+#include "K2Node_NeatBatchFunction.generated.h"
+
+/**
+ * Call function node that takes arrays instead of the inputs and outputs of the function, and calls the function once per element natively.
+ * Use "NeatBatchFunction" as UFUNCTION metadata on a static function with plain (non-container) parameters if you wish to use this node.
+ * Inputs may be passed by value or by const reference. An input array with a single element passes that element to every call.
+ * If the function is BlueprintThreadSafe, the elements are processed in parallel.
+ *
+ * Example:
+ *
+ * UFUNCTION(BlueprintPure, BlueprintThreadSafe, meta = (NeatBatchFunction))
+ * static double GetDistanceToSphere(const FVector& Location, const FVector& Center, double Radius)
+ * {
+ *		return FMath::Max(FVector::Distance(Location, Center) - Radius, 0.0);
+ * }
+ */
+UCLASS()
+class NEATFUNCTIONS_API UK2Node_NeatBatchFunction : public UK2Node_CallFunction
+{
+	GENERATED_BODY()
+
+public:
+	static inline FLazyName BatchFunctionMetadataName { "NeatBatchFunction" };
+
+	virtual void GetMenuActions(FBlueprintActionDatabaseRegistrar& ActionRegistrar) const override;
+	virtual void AllocateDefaultPins() override;
+	virtual void ExpandNode(FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph) override;
+	virtual void ValidateNodeDuringCompilation(FCompilerResultsLog& MessageLog) const override;
+	virtual FText GetNodeTitle(ENodeTitleType::Type TitleType) const override;
+	virtual bool IsNodePure() const override { return false; }
+	virtual FSlateIcon GetIconAndTint(FLinearColor& OutColor) const override;
+
+protected:
+	// Whether the pin takes or returns an array of values of a parameter of the function.
+	bool IsBatchedPin(const UEdGraphPin* Pin) const;
+
+	// Describes why the function can't be batched, or returns an empty string if it can.
+	static FString GetBatchError(const UFunction& Function);
+};
@@ -24,6 +24,8 @@ class NEATFUNCTIONS_API UK2Node_NeatCallFunction : public UK2Node_CallFunction
 
 public:
 	static const FName DelegateFunctionMetadataName;
+	static inline FLazyName CoalesceMetadataName { "NeatCoalesce" };
+	static inline FLazyName PersistentMetadataName { "NeatPersistent" };
 	
 	virtual void GetMenuActions(FBlueprintActionDatabaseRegistrar& ActionRegistrar) const override;
 	virtual void AllocateDefaultPins() override;
@@ -35,12 +37,28 @@ public:
 
 protected:
 	using FForEachDelegateFunction = TFunctionRef<void(const FDelegateProperty&)>;
-	void ForEachEligableDelegateProperty(FForEachDelegateFunction InFn);
+	void ForEachEligableDelegateProperty(FForEachDelegateFunction InFn) const;
+
+	// Whether fires of this delegate should be collapsed into a single dispatch per frame. Listed in the "NeatCoalesce" metadata of the function.
+	bool IsDelegateCoalesced(const FDelegateProperty& Prop) const;
+	static FName GetCoalescedCountPinName(const FDelegateProperty& Prop);
+
+	// Whether anything is connected to the Then pin or the parameters of this delegate. Delegates nothing uses are left unbound when compiled.
+	bool IsDelegateUsed(const FDelegateProperty& Prop) const;
 	
 	// Destroys the connection between this node's Then pin and some other node's Exec pin. Those types of connections are generally created by the autowire
 	// functionality, which we have no other way of intercepting unfortunately. This function is called when we have received a new connection between this
 	// node and some other node, when the pin of this node is actually part of a delegate, and should therefore be replaced with that delegate's Then pin instead. 
 	void QueueDestroyAutomaticExecConnection(TWeakObjectPtr<UEdGraphNode> OtherNode);
+
+	// Only lets the first execution of the node in each instance through to CallFunc. Later executions continue straight to what follows the node.
+	void ExpandPersistentGate(FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph, UK2Node_CallFunction& CallFunc);
+
+	// The function named by the "NeatPersistent" metadata, which removes the delegates bound to an owner. Null if it's missing or has the wrong signature.
+	const UFunction* GetPersistentUnbindFunction() const;
+
+	// Logs how many bytes the delegate parameters of this node add to the persistent ubergraph frame. Must be called before the pin links are moved.
+	void ReportPersistentFrameUsage(FCompilerResultsLog& MessageLog);
 	
 	UPROPERTY()
 	bool bIsNeatFunction = false;
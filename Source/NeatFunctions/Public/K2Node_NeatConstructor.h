@@ -19,6 +19,11 @@ public:
 	static inline FLazyName NeatConstructorMetadataName { "NeatConstructor" };
 	static inline FLazyName NeatConstructorFinishMetadataName { "NeatConstructorFinish" };
 	static inline FLazyName NeatValidationMetadataName { "NeatValidation" };
+	static inline FLazyName NeatSpawnPropertiesMetadataName { "NeatSpawnProperties" };
+	static inline FLazyName NeatDeferredRegistrationMetadataName { "NeatDeferredRegistration" };
+	static inline FLazyName NeatLintIgnoreMetadataName { "NeatLintIgnore" };
+	static inline FLazyName NeatClusteredMetadataName { "NeatClustered" };
+	static inline FLazyName SpawnPropertiesPinName { "SpawnProperties" };
 
 	// Logic
 	virtual void GetMenuActions(FBlueprintActionDatabaseRegistrar& ActionRegistrar) const override;
@@ -28,16 +33,22 @@ public:
 	virtual UClass* GetClassPinBaseClass() const override;
 	virtual void CreatePinsForClass(UClass* InClass, TArray<UEdGraphPin*>* OutClassPins) override;
 	virtual bool IsSpawnVarPin(UEdGraphPin* Pin) const override;
+	virtual void ReallocatePinsDuringReconstruction(TArray<UEdGraphPin*>& OldPins) override;
+	virtual void PinDefaultValueChanged(UEdGraphPin* ChangedPin) override;
+	virtual bool IsLatentForMacros() const override;
 
 	// Cosmetic
 	virtual FText GetBaseNodeTitle() const override;
 	virtual FText GetDefaultNodeTitle() const override;
 	virtual FText GetNodeTitleFormat() const override;
+	virtual FText GetNodeTitle(ENodeTitleType::Type TitleType) const override;
+	virtual FName GetCornerIcon() const override;
 
 	virtual FText GetTooltipText() const override;
 	virtual FText GetMenuCategory() const override;
 
 	virtual FSlateIcon GetIconAndTint(FLinearColor& OutColor) const override;
+	virtual TSharedPtr<SGraphNode> CreateVisualWidget() override;
 
 	// Validation
 	virtual void EarlyValidation(FCompilerResultsLog& MessageLog) const override;
@@ -55,6 +66,14 @@ public:
 	UFunction* GetFinishFunction() const;
 	FName GetFinishFunctionObjectInputName() const;
 
+	// Whether the class parameter of the function is a `TSoftClassPtr`. The node then streams the class in before spawning, which makes it latent.
+	bool IsSoftClass() const;
+	UClass* GetSoftClassDefault(const TArray<UEdGraphPin*>* InPinsToSearch = nullptr) const;
+
+	// If the class and all ExposeOnSpawn values are known at compile time, creates an archetype object with those values already applied.
+	// Returns null if any value has to be assigned at runtime, in which case regular assignment nodes should be generated.
+	UObject* CreateSpawnArchetype(FKismetCompilerContext& CompilerContext, const UClass* ClassToSpawn) const;
+
 	UPROPERTY()
 	FMemberReference FunctionReference;
 };
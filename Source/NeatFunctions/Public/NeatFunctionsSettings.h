@@ -0,0 +1,46 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "NeatFunctionsSettings.generated.h"
+
+UENUM()
+enum class ENeatLintSeverity : uint8
+{
+	Ignore,
+	Note,
+	Warning,
+	Error,
+};
+
+/**
+ * Project settings for the performance checks that run when Blueprints with Neat nodes are compiled.
+ */
+UCLASS(Config = Editor, DefaultConfig, meta = (DisplayName = "Neat Functions"))
+class NEATFUNCTIONS_API UNeatFunctionsSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	virtual FName GetCategoryName() const override { return TEXT("Plugins"); }
+
+	// Reported when a NeatConstructor node can be reached from Tick or from the body of a loop. Functions marked with "NeatLintIgnore" are never reported.
+	UPROPERTY(Config, EditAnywhere, Category = "Performance Lint")
+	ENeatLintSeverity ConstructorInTickOrLoopSeverity = ENeatLintSeverity::Warning;
+
+	// Reported when a Neat delegate passes a struct larger than the threshold, which is copied into the persistent frame on every fire.
+	UPROPERTY(Config, EditAnywhere, Category = "Performance Lint")
+	ENeatLintSeverity LargeDelegatePayloadSeverity = ENeatLintSeverity::Warning;
+
+	UPROPERTY(Config, EditAnywhere, Category = "Performance Lint", meta = (ClampMin = 1, Units = "Bytes"))
+	int32 LargeDelegatePayloadThreshold = 256;
+
+	// Reported when many ExposeOnSpawn pins are connected to pure nodes, which are evaluated again for every assignment.
+	UPROPERTY(Config, EditAnywhere, Category = "Performance Lint")
+	ENeatLintSeverity PureSpawnPinChainsSeverity = ENeatLintSeverity::Note;
+
+	UPROPERTY(Config, EditAnywhere, Category = "Performance Lint", meta = (ClampMin = 1))
+	int32 PureSpawnPinChainsThreshold = 4;
+};
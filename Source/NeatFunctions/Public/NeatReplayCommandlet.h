@@ -0,0 +1,25 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "NeatReplayCommandlet.generated.h"
+
+/**
+ * Replays a capture made by FNeatRecorder against an empty game world, frame by frame, and reports how long each frame took.
+ * Constructions call the recorded NeatConstructor function again with the recorded class. Delegate fires can't be triggered without
+ * the object that owned the delegate, so they're only counted.
+ *
+ * Usage: UnrealEditor-Cmd Project -run=NeatReplay -Capture=Path/To/NeatFunctions.neatrec [-Report=Path/To/Frames.csv] -nullrhi
+ */
+UCLASS()
+class NEATFUNCTIONS_API UNeatReplayCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UNeatReplayCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -18,6 +18,7 @@ public class NeatFunctionsRuntime : ModuleRules
             {
                 "CoreUObject",
                 "Engine",
+                "DeveloperSettings",
                 "Slate",
                 "SlateCore"
             }
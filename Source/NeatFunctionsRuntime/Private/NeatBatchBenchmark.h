@@ -0,0 +1,21 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "NeatBatchBenchmark.generated.h"
+
+/**
+ * Function measured by the `NeatFunctions.BenchmarkBatch` command. It's only reflected so it can be batched, and isn't exposed to Blueprints.
+ */
+UCLASS(Transient)
+class UNeatBatchBenchmark : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	// Distance from Location to the surface of a sphere, or 0 if it's inside.
+	UFUNCTION()
+	static double GetDistanceToSphere(const FVector& Location, const FVector& Center, double Radius);
+};
@@ -0,0 +1,298 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#include "NeatBatchCall.h"
+#include "NeatBatchBenchmark.h"
+#include "NeatFunctionsStats.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CoreDelegates.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogNeatBatchCall, Log, All);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Batched Calls"), STAT_NeatBatchedCalls, STATGROUP_NeatFunctions);
+DECLARE_CYCLE_STAT(TEXT("Execute Neat Batch"), STAT_NeatExecuteBatch, STATGROUP_NeatFunctions);
+
+namespace
+{
+	// Same as what ProcessEvent ends up doing for native functions, without the checks that only make sense for a single call.
+	void InvokeFunction(UObject* Context, UFunction* Function, uint8* Parms)
+	{
+		if (Function->HasAnyFunctionFlags(FUNC_Native))
+		{
+			FFrame Stack(Context, Function, Parms, nullptr, Function->ChildProperties);
+
+			// Native thunks read output and const reference parameters through the out parameter records of the frame.
+			TArray<FOutParmRec, TInlineAllocator<4>> OutParms;
+			for (TFieldIterator<FProperty> PropIt(Function); PropIt && PropIt->HasAnyPropertyFlags(CPF_Parm); ++PropIt)
+			{
+				if (PropIt->HasAnyPropertyFlags(CPF_OutParm) && !PropIt->HasAnyPropertyFlags(CPF_ReturnParm))
+				{
+					FOutParmRec& Out = OutParms.AddDefaulted_GetRef();
+					Out.Property = *PropIt;
+					Out.PropAddr = PropIt->ContainerPtrToValuePtr<uint8>(Parms);
+				}
+			}
+			for (int32 Index = 0; Index < OutParms.Num(); ++Index)
+			{
+				OutParms[Index].NextOutParm = OutParms.IsValidIndex(Index + 1) ? &OutParms[Index + 1] : nullptr;
+			}
+			Stack.OutParms = OutParms.Num() > 0 ? OutParms.GetData() : nullptr;
+
+			const FProperty* ReturnProp = Function->GetReturnProperty();
+			Function->Invoke(Context, Stack, ReturnProp ? Parms + ReturnProp->GetOffset_ForUFunction() : nullptr);
+		}
+		else
+		{
+			Context->ProcessEvent(Function, Parms);
+		}
+	}
+
+	// Can be run headless, e.g. `UnrealEditor-Cmd Project -game -nullrhi -ExecCmds="NeatFunctions.BenchmarkBatch 1000000, Quit"`.
+	// The baseline is one ProcessEvent per element, not a compiled Blueprint ForEach loop, which also pays for the loop macro and array access in the VM.
+	FAutoConsoleCommand BenchmarkCommand(
+		TEXT("NeatFunctions.BenchmarkBatch"),
+		TEXT("Measures a distance function on a number of locations (default 100000) through one ProcessEvent per location, and through a Neat batch."),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			const int32 Count = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100000;
+
+			UClass* BenchmarkClass = UNeatBatchBenchmark::StaticClass();
+			UFunction* Function = BenchmarkClass->FindFunctionByName(GET_FUNCTION_NAME_CHECKED(UNeatBatchBenchmark, GetDistanceToSphere));
+			const FStructProperty* LocationProp = CastField<FStructProperty>(Function->FindPropertyByName(TEXT("Location")));
+			const FStructProperty* CenterProp = CastField<FStructProperty>(Function->FindPropertyByName(TEXT("Center")));
+			const FDoubleProperty* RadiusProp = CastField<FDoubleProperty>(Function->FindPropertyByName(TEXT("Radius")));
+			const FDoubleProperty* ReturnProp = CastField<FDoubleProperty>(Function->GetReturnProperty());
+			check(LocationProp && CenterProp && RadiusProp && ReturnProp);
+
+			TArray<FVector> Locations;
+			Locations.SetNumUninitialized(Count);
+			for (int32 Index = 0; Index < Count; ++Index)
+			{
+				Locations[Index] = FVector(Index, Index * 0.5, 0.0);
+			}
+			const TArray<FVector> Centers = { FVector(100.0, 50.0, 0.0) };
+			const TArray<double> Radii = { 25.0 };
+			TArray<double> Outputs;
+			Outputs.SetNumZeroed(Count);
+
+			UObject* Context = BenchmarkClass->GetDefaultObject();
+			uint8* Parms = static_cast<uint8*>(FMemory_Alloca_Aligned(Function->ParmsSize, Function->GetMinAlignment()));
+
+			double StartTime = FPlatformTime::Seconds();
+			for (int32 Index = 0; Index < Count; ++Index)
+			{
+				FMemory::Memzero(Parms, Function->ParmsSize);
+				*LocationProp->ContainerPtrToValuePtr<FVector>(Parms) = Locations[Index];
+				*CenterProp->ContainerPtrToValuePtr<FVector>(Parms) = Centers[0];
+				RadiusProp->SetPropertyValue_InContainer(Parms, Radii[0]);
+				Context->ProcessEvent(Function, Parms);
+				Outputs[Index] = ReturnProp->GetPropertyValue_InContainer(Parms);
+			}
+			const double ProcessEventSeconds = FPlatformTime::Seconds() - StartTime;
+
+			const auto TimeBatch = [&](bool bParallel)
+			{
+				const double BatchStartTime = FPlatformTime::Seconds();
+				FNeatBatchCall Batch(Function, bParallel);
+				Batch.AddInput(LocationProp->GetFName(), LocationProp, &Locations);
+				Batch.AddInput(CenterProp->GetFName(), CenterProp, &Centers);
+				Batch.AddInput(RadiusProp->GetFName(), RadiusProp, &Radii);
+				Batch.AddOutput(ReturnProp->GetFName(), ReturnProp, &Outputs);
+				Batch.Execute();
+				return FPlatformTime::Seconds() - BatchStartTime;
+			};
+			const double BatchSeconds = TimeBatch(false);
+			const double ParallelBatchSeconds = TimeBatch(true);
+
+			UE_LOG(LogNeatBatchCall, Display, TEXT("Distance to sphere on %d locations: %.2f ms with ProcessEvent per location, %.2f ms batched, %.2f ms batched in parallel."),
+				Count, ProcessEventSeconds * 1000.0, BatchSeconds * 1000.0, ParallelBatchSeconds * 1000.0);
+		}));
+}
+
+FNeatBatchCall::FNeatBatchCall(UFunction* InFunction, bool bInParallel)
+	: Function(InFunction)
+	// Blueprint functions run in the VM, which must not be entered from several threads at once for the same object.
+	, bParallel(bInParallel && InFunction && InFunction->HasAnyFunctionFlags(FUNC_Native))
+{
+}
+
+double UNeatBatchBenchmark::GetDistanceToSphere(const FVector& Location, const FVector& Center, double Radius)
+{
+	return FMath::Max(FVector::Distance(Location, Center) - Radius, 0.0);
+}
+
+TArray<FNeatBatchCall::FPendingBatch>& FNeatBatchCall::GetPending()
+{
+	thread_local TArray<FPendingBatch> Pending;
+	return Pending;
+}
+
+int32 FNeatBatchCall::BeginPending(UFunction* Function, bool bParallel)
+{
+	// No script is running at the end of the frame, so every batch still pending on the game thread by then has been abandoned.
+	// Covers scripts aborted before executing a batch that no later batch was started on top of.
+	static const bool bEndFrameRegistered = []()
+	{
+		FCoreDelegates::OnEndFrame.AddLambda([]()
+		{
+			TArray<FPendingBatch>& Pending = GetPending();
+			UE_CLOG(Pending.Num() > 0, LogNeatBatchCall, Verbose, TEXT("Dropping %d abandoned batches."), Pending.Num());
+			Pending.Reset();
+		});
+		return true;
+	}();
+
+	thread_local int32 NextHandle = 0;
+	NextHandle = NextHandle == MAX_int32 ? 1 : NextHandle + 1;
+
+	GetPending().Add({ NextHandle, FNeatBatchCall(Function, bParallel) });
+	return NextHandle;
+}
+
+FNeatBatchCall* FNeatBatchCall::FindPending(int32 Handle)
+{
+	TArray<FPendingBatch>& Pending = GetPending();
+	for (int32 Index = Pending.Num() - 1; Index >= 0; --Index)
+	{
+		if (Pending[Index].Handle == Handle)
+			return &Pending[Index].Batch;
+	}
+	return nullptr;
+}
+
+TOptional<FNeatBatchCall> FNeatBatchCall::TakePending(int32 Handle)
+{
+	TArray<FPendingBatch>& Pending = GetPending();
+	for (int32 Index = Pending.Num() - 1; Index >= 0; --Index)
+	{
+		if (Pending[Index].Handle == Handle)
+		{
+			TOptional<FNeatBatchCall> Batch(MoveTemp(Pending[Index].Batch));
+			Pending.RemoveAt(Index, Pending.Num() - Index);
+			return Batch;
+		}
+	}
+	return {};
+}
+
+void FNeatBatchCall::AddInput(FName ParameterName, const FProperty* ElementProperty, const void* Array)
+{
+	AddArgument(ParameterName, ElementProperty, const_cast<void*>(Array), Inputs);
+}
+
+void FNeatBatchCall::AddOutput(FName ParameterName, const FProperty* ElementProperty, void* Array)
+{
+	AddArgument(ParameterName, ElementProperty, Array, Outputs);
+}
+
+bool FNeatBatchCall::AddArgument(FName ParameterName, const FProperty* ElementProperty, void* Array, TArray<FArgument>& OutArguments)
+{
+	const FProperty* Parameter = Function ? Function->FindPropertyByName(ParameterName) : nullptr;
+	if (!Parameter || !ElementProperty || !Array || !Parameter->SameType(ElementProperty))
+	{
+		UE_LOG(LogNeatBatchCall, Warning, TEXT("%s has no parameter called %s of the batched type."), *GetNameSafe(Function), *ParameterName.ToString());
+		return false;
+	}
+
+	OutArguments.Add({ Parameter, ElementProperty, Array });
+	return true;
+}
+
+int32 FNeatBatchCall::Execute()
+{
+	if (!Function || Inputs.Num() == 0)
+		return 0;
+
+	SCOPE_CYCLE_COUNTER(STAT_NeatExecuteBatch);
+
+	// Inputs with a single element are passed to every call, so they don't decide the number of elements.
+	int32 Num = INDEX_NONE;
+	for (const FArgument& Input : Inputs)
+	{
+		const int32 InputNum = FScriptArrayHelper::CreateHelperFormInnerProperty(Input.ElementProperty, Input.Array).Num();
+		if (InputNum == 1)
+			continue;
+
+		if (Num != INDEX_NONE && InputNum != Num)
+		{
+			UE_LOG(LogNeatBatchCall, Warning, TEXT("The input arrays of a batched call to %s have different lengths. Only the elements they all have are processed."), *Function->GetName());
+		}
+		Num = Num == INDEX_NONE ? InputNum : FMath::Min(Num, InputNum);
+	}
+	Num = Num == INDEX_NONE ? 1 : Num;
+
+	for (const FArgument& Output : Outputs)
+	{
+		FScriptArrayHelper::CreateHelperFormInnerProperty(Output.ElementProperty, Output.Array).EmptyAndAddValues(Num);
+	}
+
+	if (bParallel && Num > ChunkSize)
+	{
+		const int32 NumChunks = FMath::DivideAndRoundUp(Num, ChunkSize);
+		ParallelFor(NumChunks, [this, Num](int32 ChunkIndex)
+		{
+			ExecuteRange(ChunkIndex * ChunkSize, FMath::Min(Num, (ChunkIndex + 1) * ChunkSize));
+		});
+	}
+	else
+	{
+		ExecuteRange(0, Num);
+	}
+
+	INC_DWORD_STAT_BY(STAT_NeatBatchedCalls, Num);
+	return Num;
+}
+
+void FNeatBatchCall::ExecuteRange(int32 Begin, int32 End) const
+{
+	if (Begin >= End)
+		return;
+
+	UObject* Context = Function->GetOwnerClass()->GetDefaultObject();
+
+	// Each range gets its own parameters, which are reused for every element in it.
+	uint8* Parms = static_cast<uint8*>(FMemory::Malloc(FMath::Max(Function->ParmsSize, 1), Function->GetMinAlignment()));
+	FMemory::Memzero(Parms, Function->ParmsSize);
+	for (TFieldIterator<FProperty> PropIt(Function); PropIt && PropIt->HasAnyPropertyFlags(CPF_Parm); ++PropIt)
+	{
+		PropIt->InitializeValue_InContainer(Parms);
+	}
+
+	// Broadcast inputs are only copied once. Batched functions take their inputs by value or const reference, so calls can't change them in between.
+	TArray<const FArgument*, TInlineAllocator<8>> ElementInputs;
+	for (const FArgument& Input : Inputs)
+	{
+		FScriptArrayHelper Helper = FScriptArrayHelper::CreateHelperFormInnerProperty(Input.ElementProperty, Input.Array);
+		if (Helper.Num() == 1)
+		{
+			Input.Parameter->CopyCompleteValue(Input.Parameter->ContainerPtrToValuePtr<void>(Parms), Helper.GetRawPtr(0));
+		}
+		else
+		{
+			ElementInputs.Add(&Input);
+		}
+	}
+
+	for (int32 Index = Begin; Index < End; ++Index)
+	{
+		for (const FArgument* Input : ElementInputs)
+		{
+			FScriptArrayHelper Helper = FScriptArrayHelper::CreateHelperFormInnerProperty(Input->ElementProperty, Input->Array);
+			Input->Parameter->CopyCompleteValue(Input->Parameter->ContainerPtrToValuePtr<void>(Parms), Helper.GetRawPtr(Index));
+		}
+
+		InvokeFunction(Context, Function, Parms);
+
+		for (const FArgument& Output : Outputs)
+		{
+			FScriptArrayHelper Helper = FScriptArrayHelper::CreateHelperFormInnerProperty(Output.ElementProperty, Output.Array);
+			Output.Parameter->CopyCompleteValue(Helper.GetRawPtr(Index), Output.Parameter->ContainerPtrToValuePtr<void>(Parms));
+		}
+	}
+
+	for (TFieldIterator<FProperty> PropIt(Function); PropIt && PropIt->HasAnyPropertyFlags(CPF_Parm); ++PropIt)
+	{
+		PropIt->DestroyValue_InContainer(Parms);
+	}
+	FMemory::Free(Parms);
+}
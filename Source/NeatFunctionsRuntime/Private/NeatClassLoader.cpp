@@ -0,0 +1,54 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#include "NeatClassLoader.h"
+#include "NeatFunctionsStats.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogNeatClassLoader, Log, All);
+
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Class Load Wait Time (s)"), STAT_NeatClassLoadWaitTime, STATGROUP_NeatFunctions);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Class Load Requests"), STAT_NeatClassLoadRequests, STATGROUP_NeatFunctions);
+
+FNeatClassLoader& FNeatClassLoader::Get()
+{
+	static FNeatClassLoader Inst;
+	return Inst;
+}
+
+TSharedPtr<FStreamableHandle> FNeatClassLoader::RequestClass(const FSoftObjectPath& ClassPath)
+{
+	INC_DWORD_STAT(STAT_NeatClassLoadRequests);
+	NumRequests++;
+
+	if (const TWeakPtr<FStreamableHandle>* Existing = InFlight.Find(ClassPath))
+	{
+		TSharedPtr<FStreamableHandle> Handle = Existing->Pin();
+		if (Handle.IsValid() && Handle->IsLoadingInProgress())
+		{
+			NumSharedRequests++;
+			return Handle;
+		}
+
+		// The request was canceled, or released before it completed.
+		InFlight.Remove(ClassPath);
+	}
+
+	// The wait is measured by the request itself, so it's only counted once however many nodes share it.
+	TSharedPtr<FStreamableHandle> Handle = StreamableManager.RequestAsyncLoad(ClassPath,
+		FStreamableDelegate::CreateRaw(this, &FNeatClassLoader::OnClassLoaded, ClassPath, FPlatformTime::Seconds()));
+	if (Handle.IsValid() && Handle->IsLoadingInProgress())
+	{
+		InFlight.Add(ClassPath, Handle);
+	}
+	return Handle;
+}
+
+void FNeatClassLoader::OnClassLoaded(FSoftObjectPath ClassPath, double StartTime)
+{
+	InFlight.Remove(ClassPath);
+
+	const double Seconds = FPlatformTime::Seconds() - StartTime;
+	TotalWaitSeconds += Seconds;
+	INC_FLOAT_STAT_BY(STAT_NeatClassLoadWaitTime, Seconds);
+
+	UE_LOG(LogNeatClassLoader, Verbose, TEXT("Waited %.2f ms for %s to load."), Seconds * 1000.0, *ClassPath.ToString());
+}
@@ -0,0 +1,105 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#include "NeatDeferredComponentRegistration.h"
+#include "NeatFunctionsStats.h"
+#include "Components/ActorComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "Misc/CoreDelegates.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogNeatDeferredComponentRegistration, Log, All);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Deferred Component Registrations"), STAT_NeatDeferredComponentRegistrations, STATGROUP_NeatFunctions);
+DECLARE_CYCLE_STAT(TEXT("Flush Deferred Component Registrations"), STAT_NeatFlushDeferredComponentRegistrations, STATGROUP_NeatFunctions);
+
+FNeatDeferredComponentRegistration& FNeatDeferredComponentRegistration::Get()
+{
+	static FNeatDeferredComponentRegistration Inst;
+	return Inst;
+}
+
+void FNeatDeferredComponentRegistration::Defer(UActorComponent* Component)
+{
+	check(IsInGameThread());
+
+	if (!Component || Component->IsRegistered())
+		return;
+
+	Pending.Add(Component);
+
+	if (!EndFrameHandle.IsValid())
+	{
+		EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FNeatDeferredComponentRegistration::OnEndFrame);
+		PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddLambda([this](UWorld* World, ELevelTick, float)
+		{
+			Flush(World);
+		});
+		PreExitHandle = FCoreDelegates::OnPreExit.AddRaw(this, &FNeatDeferredComponentRegistration::RemoveDelegates);
+	}
+}
+
+void FNeatDeferredComponentRegistration::RemoveDelegates()
+{
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	FCoreDelegates::OnPreExit.Remove(PreExitHandle);
+
+	EndFrameHandle.Reset();
+	PostActorTickHandle.Reset();
+	PreExitHandle.Reset();
+}
+
+void FNeatDeferredComponentRegistration::Flush(const UWorld* OnlyWorld)
+{
+	if (Pending.Num() == 0)
+		return;
+
+	SCOPE_CYCLE_COUNTER(STAT_NeatFlushDeferredComponentRegistrations);
+
+	// Group components per world, since each registration context can only process a single world.
+	TMap<UWorld*, TArray<UActorComponent*>> ComponentsPerWorld;
+	for (auto It = Pending.CreateIterator(); It; ++It)
+	{
+		UActorComponent* Component = It->Get();
+		const AActor* Owner = Component ? Component->GetOwner() : nullptr;
+
+		// Components created without an owning actor still belong to the world of their outer.
+		UWorld* World = Owner && Owner->GetWorld() ? Owner->GetWorld() : (Component ? Component->GetWorld() : nullptr);
+		if (OnlyWorld && World != OnlyWorld)
+			continue;
+
+		It.RemoveCurrent();
+		if (!Component || Component->IsRegistered())
+			continue;
+
+		if (World)
+		{
+			ComponentsPerWorld.FindOrAdd(World).Add(Component);
+		}
+		else
+		{
+			UE_LOG(LogNeatDeferredComponentRegistration, Warning, TEXT("%s was dropped from deferred registration, since it isn't in a world."), *Component->GetPathName());
+		}
+	}
+
+	for (const TPair<UWorld*, TArray<UActorComponent*>>& Pair : ComponentsPerWorld)
+	{
+		FRegisterComponentContext Context(Pair.Key);
+		for (UActorComponent* Component : Pair.Value)
+		{
+			Component->RegisterComponentWithWorld(Pair.Key, &Context);
+		}
+		Context.Process();
+
+		NumRegisteredThisFrame += Pair.Value.Num();
+		INC_DWORD_STAT_BY(STAT_NeatDeferredComponentRegistrations, Pair.Value.Num());
+	}
+}
+
+void FNeatDeferredComponentRegistration::OnEndFrame()
+{
+	Flush();
+
+	NumRegisteredLastFrame = NumRegisteredThisFrame;
+	NumRegisteredThisFrame = 0;
+}
@@ -0,0 +1,105 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#include "NeatDelegateCoalescer.h"
+#include "NeatFunctionsStats.h"
+#include "Engine/World.h"
+#include "Misc/CoreDelegates.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Coalesced Delegate Fires"), STAT_NeatCoalescedFires, STATGROUP_NeatFunctions);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Coalesced Delegate Dispatches"), STAT_NeatCoalescedDispatches, STATGROUP_NeatFunctions);
+
+FNeatDelegateCoalescer& FNeatDelegateCoalescer::Get()
+{
+	static FNeatDelegateCoalescer Inst;
+	return Inst;
+}
+
+void FNeatDelegateCoalescer::Queue(const FNeatCoalescedDispatch& Dispatch)
+{
+	check(IsInGameThread());
+
+	UObject* Target = Dispatch.GetUObject();
+	if (!Target)
+		return;
+
+	INC_DWORD_STAT(STAT_NeatCoalescedFires);
+
+	FDispatchMap& WorldPending = PendingPerWorld.FindOrAdd(Target->GetWorld());
+	FPendingDispatch& PendingDispatch = WorldPending.FindOrAdd(MakeTuple(TObjectKey<UObject>(Target), Dispatch.GetFunctionName()));
+	if (PendingDispatch.FireCount > 0)
+	{
+		NumAbsorbedThisFrame++;
+		TotalAbsorbed++;
+	}
+	PendingDispatch.Dispatch = Dispatch;
+	PendingDispatch.FireCount++;
+
+	if (!PostActorTickHandle.IsValid())
+	{
+		PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddRaw(this, &FNeatDelegateCoalescer::OnWorldPostActorTick);
+		EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FNeatDelegateCoalescer::OnEndFrame);
+		PreExitHandle = FCoreDelegates::OnPreExit.AddRaw(this, &FNeatDelegateCoalescer::RemoveDelegates);
+	}
+}
+
+void FNeatDelegateCoalescer::Flush()
+{
+	TArray<TObjectKey<UWorld>> Worlds;
+	PendingPerWorld.GetKeys(Worlds);
+	for (const TObjectKey<UWorld>& World : Worlds)
+	{
+		FlushWorld(World);
+	}
+}
+
+void FNeatDelegateCoalescer::FlushWorld(TObjectKey<UWorld> World)
+{
+	// The dispatched Blueprint logic may fire the same delegates again, which should end up in the next batch.
+	FDispatchMap Dispatching;
+	if (!PendingPerWorld.RemoveAndCopyValue(World, Dispatching))
+		return;
+
+	for (const TPair<TPair<TObjectKey<UObject>, FName>, FPendingDispatch>& Pair : Dispatching)
+	{
+		INC_DWORD_STAT(STAT_NeatCoalescedDispatches);
+		Pair.Value.Dispatch.ExecuteIfBound(Pair.Value.FireCount);
+	}
+}
+
+void FNeatDelegateCoalescer::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	// Like the Blueprint logic that fired them, dispatches wait while the world is paused, or while only its viewports tick in the editor.
+	if (!World || TickType == LEVELTICK_ViewportsOnly || World->IsPaused())
+		return;
+
+	FlushWorld(World);
+}
+
+void FNeatDelegateCoalescer::OnEndFrame()
+{
+	// Objects outside of any world have no world tick to be dispatched from.
+	FlushWorld(TObjectKey<UWorld>());
+
+	// Worlds that have been destroyed will never tick again.
+	for (auto It = PendingPerWorld.CreateIterator(); It; ++It)
+	{
+		if (It.Key() != TObjectKey<UWorld>() && !It.Key().ResolveObjectPtr())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	NumAbsorbedLastFrame = NumAbsorbedThisFrame;
+	NumAbsorbedThisFrame = 0;
+}
+
+void FNeatDelegateCoalescer::RemoveDelegates()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+	FCoreDelegates::OnPreExit.Remove(PreExitHandle);
+
+	PostActorTickHandle.Reset();
+	EndFrameHandle.Reset();
+	PreExitHandle.Reset();
+}
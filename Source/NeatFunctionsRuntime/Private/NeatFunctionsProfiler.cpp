@@ -0,0 +1,169 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#include "NeatFunctionsProfiler.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogNeatFunctionsProfiler, Log, All);
+
+namespace
+{
+	constexpr int32 CaptureVersion = 1;
+
+	bool bProfilingEnabled = false;
+	FAutoConsoleVariableRef CVarProfiling(
+		TEXT("NeatFunctions.Profiling"),
+		bProfilingEnabled,
+		TEXT("Enables sampling of call counts and time spent in instrumented Neat nodes."));
+
+	FString GetCaptureFilename(const TArray<FString>& Args)
+	{
+		return Args.Num() > 0 ? Args[0] : FPaths::ProfilingDir() / TEXT("NeatFunctions.neatprof");
+	}
+
+	FAutoConsoleCommand SaveCaptureCommand(
+		TEXT("NeatFunctions.Profiling.Save"),
+		TEXT("Saves the current Neat node samples to a capture file. Optionally takes a filename."),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			FNeatFunctionsProfiler::Get().SaveCapture(GetCaptureFilename(Args));
+		}));
+
+	FAutoConsoleCommand LoadCaptureCommand(
+		TEXT("NeatFunctions.Profiling.Load"),
+		TEXT("Replaces the current Neat node samples with the ones in a capture file. Optionally takes a filename."),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			FNeatFunctionsProfiler::Get().LoadCapture(GetCaptureFilename(Args));
+		}));
+
+	FAutoConsoleCommand ResetCommand(
+		TEXT("NeatFunctions.Profiling.Reset"),
+		TEXT("Clears all Neat node samples."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			FNeatFunctionsProfiler::Get().Reset();
+		}));
+}
+
+double FNeatNodeStats::GetCallsPerFrame() const
+{
+	const uint64 NumFrames = LastFrame - FirstFrame + 1;
+	return CallCount > 0 ? static_cast<double>(CallCount) / NumFrames : 0.0;
+}
+
+double FNeatNodeStats::GetAverageMicroseconds() const
+{
+	return CallCount > 0 ? TotalSeconds * 1000000.0 / CallCount : 0.0;
+}
+
+FArchive& operator<<(FArchive& Ar, FNeatNodeStats& Stats)
+{
+	Ar << Stats.CallCount;
+	Ar << Stats.TotalSeconds;
+	Ar << Stats.FirstFrame;
+	Ar << Stats.LastFrame;
+	return Ar;
+}
+
+FNeatFunctionsProfiler& FNeatFunctionsProfiler::Get()
+{
+	static FNeatFunctionsProfiler Inst;
+	return Inst;
+}
+
+bool FNeatFunctionsProfiler::IsEnabled() const
+{
+	return bProfilingEnabled;
+}
+
+void FNeatFunctionsProfiler::BeginSample(const FGuid& NodeGuid)
+{
+	if (!bProfilingEnabled || !IsInGameThread())
+		return;
+
+	OpenSamples.Emplace(NodeGuid, FPlatformTime::Seconds());
+}
+
+void FNeatFunctionsProfiler::EndSample(const FGuid& NodeGuid)
+{
+	if (!IsInGameThread())
+		return;
+
+	// Profiling may have been toggled between the begin and end of a sample, so only close samples we actually opened.
+	const int32 Index = OpenSamples.FindLastByPredicate([&NodeGuid](const TPair<FGuid, double>& Sample) { return Sample.Key == NodeGuid; });
+	if (Index == INDEX_NONE)
+		return;
+
+	const double Elapsed = FPlatformTime::Seconds() - OpenSamples[Index].Value;
+	OpenSamples.RemoveAt(Index, OpenSamples.Num() - Index);
+
+	FNeatNodeStats& NodeStats = Stats.FindOrAdd(NodeGuid);
+	if (NodeStats.CallCount == 0)
+		NodeStats.FirstFrame = GFrameCounter;
+
+	NodeStats.CallCount++;
+	NodeStats.TotalSeconds += Elapsed;
+	NodeStats.LastFrame = GFrameCounter;
+
+	MaxTotalSeconds = FMath::Max(MaxTotalSeconds, NodeStats.TotalSeconds);
+}
+
+const FNeatNodeStats* FNeatFunctionsProfiler::FindStats(const FGuid& NodeGuid) const
+{
+	return Stats.Find(NodeGuid);
+}
+
+void FNeatFunctionsProfiler::Reset()
+{
+	Stats.Reset();
+	OpenSamples.Reset();
+	MaxTotalSeconds = 0.0;
+}
+
+bool FNeatFunctionsProfiler::SaveCapture(const FString& Filename) const
+{
+	const TUniquePtr<FArchive> Ar(IFileManager::Get().CreateFileWriter(*Filename));
+	if (!Ar)
+	{
+		UE_LOG(LogNeatFunctionsProfiler, Error, TEXT("Failed to write Neat profiling capture to %s."), *Filename);
+		return false;
+	}
+
+	int32 Version = CaptureVersion;
+	*Ar << Version;
+	*Ar << const_cast<TMap<FGuid, FNeatNodeStats>&>(Stats);
+
+	UE_LOG(LogNeatFunctionsProfiler, Display, TEXT("Saved %d Neat node samples to %s."), Stats.Num(), *Filename);
+	return true;
+}
+
+bool FNeatFunctionsProfiler::LoadCapture(const FString& Filename)
+{
+	const TUniquePtr<FArchive> Ar(IFileManager::Get().CreateFileReader(*Filename));
+	if (!Ar)
+	{
+		UE_LOG(LogNeatFunctionsProfiler, Error, TEXT("Failed to read Neat profiling capture from %s."), *Filename);
+		return false;
+	}
+
+	int32 Version = 0;
+	*Ar << Version;
+	if (Version != CaptureVersion)
+	{
+		UE_LOG(LogNeatFunctionsProfiler, Error, TEXT("%s has unsupported version %d."), *Filename, Version);
+		return false;
+	}
+
+	Reset();
+	*Ar << Stats;
+
+	for (const TPair<FGuid, FNeatNodeStats>& Pair : Stats)
+	{
+		MaxTotalSeconds = FMath::Max(MaxTotalSeconds, Pair.Value.TotalSeconds);
+	}
+
+	UE_LOG(LogNeatFunctionsProfiler, Display, TEXT("Loaded %d Neat node samples from %s."), Stats.Num(), *Filename);
+	return true;
+}
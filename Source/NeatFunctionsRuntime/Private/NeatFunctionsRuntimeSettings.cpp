@@ -0,0 +1,12 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#include "NeatFunctionsRuntimeSettings.h"
+#include "NeatMemoizer.h"
+
+#if WITH_EDITOR
+void UNeatFunctionsRuntimeSettings::RefreshMemoizedFunctions()
+{
+	MemoizedFunctions = FNeatMemoizer::FindTaggedFunctionPaths();
+	TryUpdateDefaultConfigFile();
+}
+#endif
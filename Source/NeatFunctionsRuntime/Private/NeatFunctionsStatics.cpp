@@ -2,6 +2,437 @@
 
 
 #include "NeatFunctionsStatics.h"
+#include "NeatBatchCall.h"
+#include "NeatClassLoader.h"
+#include "NeatDeferredComponentRegistration.h"
+#include "NeatDelegateCoalescer.h"
+#include "NeatFunctionsProfiler.h"
+#include "NeatFunctionsRuntimeSettings.h"
+#include "NeatMemoizer.h"
+#include "NeatObjectCluster.h"
+#include "NeatPersistentBindings.h"
+#include "NeatRecorder.h"
+#include "Engine/Engine.h"
+#include "Kismet/KismetSystemLibrary.h"
+#include "HAL/IConsoleManager.h"
+#include "LatentActions.h"
+#include "ProfilingDebugging/CountersTrace.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogNeatFunctionsRuntime, Log, All);
+
+TRACE_DECLARE_MEMORY_COUNTER(NeatMovedBytes, TEXT("NeatFunctions/MovedBytes"));
+TRACE_DECLARE_MEMORY_COUNTER(NeatCopiedBytes, TEXT("NeatFunctions/CopiedBytes"));
+
+namespace
+{
+	// The properties that differ between an archetype and its class default object never change after compilation,
+	// so we only compare them once per archetype and keep the result around.
+	TMap<TObjectKey<UObject>, TArray<const FProperty*>> ArchetypeDeltaLUT;
+
+	struct FSpawnPropertyMap
+	{
+		struct FEntry
+		{
+			const FProperty* Property = nullptr;
+			int32 Offset = 0;
+
+			// The BlueprintSetter of the property, which has to be called instead of writing the value directly.
+			UFunction* Setter = nullptr;
+
+			// Values already imported from text, for plain old data properties. Anything else is imported on every spawn, since freeing a cached copy
+			// needs the property, which may already be gone by the time the cache is reset.
+			TMap<FString, TArray<uint8, TAlignedHeapAllocator<16>>> ParsedValues;
+		};
+
+		bool bBuilt = false;
+		TMap<FName, FEntry> Entries;
+	};
+
+	// Each property only caches a few distinct values, since they usually come from a handful of literals in the graph.
+	constexpr int32 MaxParsedValuesPerProperty = 16;
+
+	// Built on first use for each class, so spawning dynamic classes doesn't have to search for properties by name on every spawn.
+	TMap<TObjectKey<UClass>, FSpawnPropertyMap> SpawnPropertyMapLUT;
+
+	void PrunePropertyCaches()
+	{
+		for (auto It = ArchetypeDeltaLUT.CreateIterator(); It; ++It)
+		{
+			if (!It.Key().ResolveObjectPtr())
+			{
+				It.RemoveCurrent();
+			}
+		}
+		for (auto It = SpawnPropertyMapLUT.CreateIterator(); It; ++It)
+		{
+			if (!It.Key().ResolveObjectPtr())
+			{
+				It.RemoveCurrent();
+			}
+		}
+	}
+
+	void ResetPropertyCaches()
+	{
+		ArchetypeDeltaLUT.Reset();
+		SpawnPropertyMapLUT.Reset();
+	}
+
+	void RegisterPropertyCacheCleanup()
+	{
+		// Recompiling a Blueprint recreates the properties of its class, so nothing cached can be trusted once objects have been reinstanced.
+		static const bool bCleanupRegistered = []()
+		{
+			FCoreUObjectDelegates::GetPostGarbageCollect().AddStatic(&PrunePropertyCaches);
+			FCoreUObjectDelegates::ReloadCompleteDelegate.AddLambda([](EReloadCompleteReason) { ResetPropertyCaches(); });
+#if WITH_EDITOR
+			FCoreUObjectDelegates::OnObjectsReplaced.AddLambda([](const TMap<UObject*, UObject*>&) { ResetPropertyCaches(); });
+#endif
+			return true;
+		}();
+	}
+
+	const TArray<const FProperty*>& GetArchetypeDelta(const UObject& Archetype)
+	{
+		RegisterPropertyCacheCleanup();
+
+		if (const TArray<const FProperty*>* Delta = ArchetypeDeltaLUT.Find(&Archetype))
+			return *Delta;
+
+		TArray<const FProperty*>& Delta = ArchetypeDeltaLUT.Add(&Archetype);
+		const UObject* CDO = Archetype.GetClass()->GetDefaultObject();
+		for (TFieldIterator<FProperty> PropIt(Archetype.GetClass()); PropIt; ++PropIt)
+		{
+			const FProperty* Property = *PropIt;
+
+			// Only ExposeOnSpawn properties can be set by the node. Instanced references must never be shared with the archetype.
+			if (!Property->HasAnyPropertyFlags(CPF_ExposeOnSpawn) || Property->HasAnyPropertyFlags(CPF_InstancedReference | CPF_ContainsInstancedReference))
+				continue;
+
+			if (!Property->Identical_InContainer(&Archetype, CDO))
+				Delta.Add(Property);
+		}
+		return Delta;
+	}
+
+	// The function an assignment node calls for a property without a setter, which is one of the Set*PropertyByName functions of UKismetSystemLibrary.
+	UFunction* FindSetByNameFunction(const FProperty& Property)
+	{
+		static const FName FunctionNames[] =
+		{
+			TEXT("SetIntPropertyByName"), TEXT("SetInt64PropertyByName"), TEXT("SetBytePropertyByName"),
+			TEXT("SetDoublePropertyByName"), TEXT("SetBoolPropertyByName"), TEXT("SetStringPropertyByName"),
+		};
+		for (const FName& FunctionName : FunctionNames)
+		{
+			UFunction* Function = UKismetSystemLibrary::StaticClass()->FindFunctionByName(FunctionName);
+			const FProperty* ValueParam = Function ? Function->FindPropertyByName(TEXT("Value")) : nullptr;
+			if (ValueParam && ValueParam->SameType(&Property))
+				return Function;
+		}
+		return nullptr;
+	}
+
+	using FBenchmarkParms = TArray<uint8, TAlignedHeapAllocator<16>>;
+
+	void InitializeBenchmarkParms(const UFunction& Function, FBenchmarkParms& Parms)
+	{
+		Parms.SetNumZeroed(FMath::Max<int32>(Function.ParmsSize, 1));
+		for (TFieldIterator<FProperty> PropIt(&Function); PropIt && PropIt->HasAnyPropertyFlags(CPF_Parm); ++PropIt)
+		{
+			PropIt->InitializeValue_InContainer(Parms.GetData());
+		}
+	}
+
+	void DestroyBenchmarkParms(const UFunction& Function, FBenchmarkParms& Parms)
+	{
+		for (TFieldIterator<FProperty> PropIt(&Function); PropIt && PropIt->HasAnyPropertyFlags(CPF_Parm); ++PropIt)
+		{
+			PropIt->DestroyValue_InContainer(Parms.GetData());
+		}
+	}
+
+	// Gives every simple ExposeOnSpawn property of the archetype a value that differs from the class default.
+	// Only properties an assignment node would set through a Set*PropertyByName function are changed, so both sides of the benchmark assign the same properties.
+	void MakeBenchmarkArchetype(UObject& Archetype)
+	{
+		for (TFieldIterator<FProperty> PropIt(Archetype.GetClass()); PropIt; ++PropIt)
+		{
+			if (!PropIt->HasAnyPropertyFlags(CPF_ExposeOnSpawn) || !FindSetByNameFunction(**PropIt))
+				continue;
+
+			void* Value = PropIt->ContainerPtrToValuePtr<void>(&Archetype);
+			if (const FNumericProperty* NumericProp = CastField<FNumericProperty>(*PropIt); NumericProp && !NumericProp->IsEnum())
+			{
+				if (NumericProp->IsFloatingPoint())
+					NumericProp->SetFloatingPointPropertyValue(Value, NumericProp->GetFloatingPointPropertyValue(Value) + 1.0);
+				else
+					NumericProp->SetIntPropertyValue(Value, NumericProp->GetSignedIntPropertyValue(Value) + 1);
+			}
+			else if (const FBoolProperty* BoolProp = CastField<FBoolProperty>(*PropIt))
+			{
+				BoolProp->SetPropertyValue(Value, !BoolProp->GetPropertyValue(Value));
+			}
+			else if (const FStrProperty* StrProp = CastField<FStrProperty>(*PropIt))
+			{
+				StrProp->SetPropertyValue(Value, TEXT("NeatArchetype"));
+			}
+		}
+	}
+
+	// Can be run headless, e.g. `UnrealEditor-Cmd Project -game -nullrhi -ExecCmds="NeatFunctions.BenchmarkArchetype /Game/BP_Enemy.BP_Enemy_C 100000, Quit"`.
+	FAutoConsoleCommand BenchmarkArchetypeCommand(
+		TEXT("NeatFunctions.BenchmarkArchetype"),
+		TEXT("Takes a class path and a number of repetitions (default 100000). Measures assigning the ExposeOnSpawn properties of the class by calling the Set*PropertyByName function "
+			"each assignment node calls, once per property, and applying them all from a baked archetype in a single call. Both go through ProcessEvent, "
+			"so the Blueprint VM stepping between nodes, which only adds to the cost of the assignment nodes, isn't included."),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			UClass* Class = Args.Num() > 0 ? LoadObject<UClass>(nullptr, *Args[0]) : nullptr;
+			if (!Class)
+			{
+				UE_LOG(LogNeatFunctionsRuntime, Error, TEXT("Pass the path of a class with ExposeOnSpawn properties, e.g. /Game/BP_Enemy.BP_Enemy_C."));
+				return;
+			}
+			const int32 Count = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 100000;
+
+			UObject* Archetype = NewObject<UObject>(GetTransientPackage(), Class, NAME_None, RF_Transient | RF_ArchetypeObject);
+			UObject* Object = NewObject<UObject>(GetTransientPackage(), Class, NAME_None, RF_Transient | RF_ArchetypeObject);
+			MakeBenchmarkArchetype(*Archetype);
+
+			// One call per property, with the same parameters the assignment node would pass.
+			struct FAssignmentCall
+			{
+				UFunction* Function = nullptr;
+				FBenchmarkParms Parms;
+			};
+			TArray<FAssignmentCall> AssignmentCalls;
+			for (const FProperty* Property : GetArchetypeDelta(*Archetype))
+			{
+				FAssignmentCall& Call = AssignmentCalls.AddDefaulted_GetRef();
+				Call.Function = FindSetByNameFunction(*Property);
+				InitializeBenchmarkParms(*Call.Function, Call.Parms);
+
+				CastFieldChecked<FObjectPropertyBase>(Call.Function->FindPropertyByName(TEXT("Object")))->SetObjectPropertyValue_InContainer(Call.Parms.GetData(), Object);
+				CastFieldChecked<FNameProperty>(Call.Function->FindPropertyByName(TEXT("PropertyName")))->SetPropertyValue_InContainer(Call.Parms.GetData(), Property->GetFName());
+				const FProperty* ValueParam = Call.Function->FindPropertyByName(TEXT("Value"));
+				ValueParam->CopyCompleteValue(ValueParam->ContainerPtrToValuePtr<void>(Call.Parms.GetData()), Property->ContainerPtrToValuePtr<void>(Archetype));
+			}
+			if (AssignmentCalls.Num() == 0)
+			{
+				UE_LOG(LogNeatFunctionsRuntime, Error, TEXT("%s has no numeric, bool or string ExposeOnSpawn properties to benchmark with."), *Class->GetName());
+				return;
+			}
+
+			UFunction* ApplyFunction = UNeatFunctionsStatics::StaticClass()->FindFunctionByName(GET_FUNCTION_NAME_CHECKED(UNeatFunctionsStatics, ApplyNeatArchetype));
+			FBenchmarkParms ApplyParms;
+			InitializeBenchmarkParms(*ApplyFunction, ApplyParms);
+			CastFieldChecked<FObjectPropertyBase>(ApplyFunction->FindPropertyByName(TEXT("Object")))->SetObjectPropertyValue_InContainer(ApplyParms.GetData(), Object);
+			CastFieldChecked<FObjectPropertyBase>(ApplyFunction->FindPropertyByName(TEXT("Archetype")))->SetObjectPropertyValue_InContainer(ApplyParms.GetData(), Archetype);
+
+			UObject* KismetSystemLibrary = UKismetSystemLibrary::StaticClass()->GetDefaultObject();
+			double StartTime = FPlatformTime::Seconds();
+			for (int32 Index = 0; Index < Count; ++Index)
+			{
+				for (FAssignmentCall& Call : AssignmentCalls)
+				{
+					KismetSystemLibrary->ProcessEvent(Call.Function, Call.Parms.GetData());
+				}
+			}
+			const double AssignmentSeconds = FPlatformTime::Seconds() - StartTime;
+
+			UObject* NeatFunctionsStatics = UNeatFunctionsStatics::StaticClass()->GetDefaultObject();
+			StartTime = FPlatformTime::Seconds();
+			for (int32 Index = 0; Index < Count; ++Index)
+			{
+				NeatFunctionsStatics->ProcessEvent(ApplyFunction, ApplyParms.GetData());
+			}
+			const double ArchetypeSeconds = FPlatformTime::Seconds() - StartTime;
+
+			UE_LOG(LogNeatFunctionsRuntime, Display, TEXT("%d properties of %s assigned %d times: %.2f ms with one assignment call per property, %.2f ms with one archetype call."),
+				AssignmentCalls.Num(), *Class->GetName(), Count, AssignmentSeconds * 1000.0, ArchetypeSeconds * 1000.0);
+
+			for (FAssignmentCall& Call : AssignmentCalls)
+			{
+				DestroyBenchmarkParms(*Call.Function, Call.Parms);
+			}
+			DestroyBenchmarkParms(*ApplyFunction, ApplyParms);
+			Archetype->MarkAsGarbage();
+			Object->MarkAsGarbage();
+		}));
+
+	class FNeatLoadClassAction : public FPendingLatentAction
+	{
+	public:
+		FNeatLoadClassAction(const FSoftObjectPath& InClassPath, const FLatentActionInfo& LatentInfo)
+			: ClassPath(InClassPath)
+			, Handle(FNeatClassLoader::Get().RequestClass(InClassPath))
+			, ExecutionFunction(LatentInfo.ExecutionFunction)
+			, OutputLink(LatentInfo.Linkage)
+			, CallbackTarget(LatentInfo.CallbackTarget)
+		{
+		}
+
+		virtual void UpdateOperation(FLatentResponse& Response) override
+		{
+			const bool bDone = !Handle.IsValid() || Handle->HasLoadCompleted() || Handle->WasCanceled();
+			Response.FinishAndTriggerIf(bDone, ExecutionFunction, OutputLink, CallbackTarget);
+		}
+
+#if WITH_EDITOR
+		virtual FString GetDescription() const override
+		{
+			return FString::Printf(TEXT("Loading %s"), *ClassPath.ToString());
+		}
+#endif
+
+	private:
+		FSoftObjectPath ClassPath;
+		TSharedPtr<FStreamableHandle> Handle;
+		FName ExecutionFunction;
+		int32 OutputLink;
+		FWeakObjectPtr CallbackTarget;
+	};
+
+	// Approximate number of bytes a copy of the value has to duplicate, including the elements of containers.
+	int64 GetValueBytes(const FProperty& Property, const void* Value)
+	{
+		if (const FArrayProperty* ArrayProp = CastField<FArrayProperty>(&Property))
+			return static_cast<int64>(FScriptArrayHelper(ArrayProp, Value).Num()) * ArrayProp->Inner->GetSize();
+
+		if (const FMapProperty* MapProp = CastField<FMapProperty>(&Property))
+			return static_cast<int64>(FScriptMapHelper(MapProp, Value).Num()) * MapProp->MapLayout.SetLayout.Size;
+
+		if (const FSetProperty* SetProp = CastField<FSetProperty>(&Property))
+			return static_cast<int64>(FScriptSetHelper(SetProp, Value).Num()) * SetProp->SetLayout.Size;
+
+		if (CastField<FStrProperty>(&Property))
+			return static_cast<const FString*>(Value)->GetAllocatedSize();
+
+		return Property.GetSize();
+	}
+
+	FName FindSetterName(const FProperty& Property)
+	{
+#if WITH_EDITORONLY_DATA
+		const FString& SetterName = Property.GetMetaData(TEXT("BlueprintSetter"));
+		return SetterName.IsEmpty() ? NAME_None : FName(*SetterName);
+#else
+		// Metadata is stripped from packaged builds, so the setters are stored in the runtime settings.
+		const FName* SetterName = GetDefault<UNeatFunctionsRuntimeSettings>()->PropertySetters.Find(Property.GetPathName());
+		return SetterName ? *SetterName : NAME_None;
+#endif
+	}
+
+	FSpawnPropertyMap& GetSpawnPropertyMap(const UClass& Class)
+	{
+		RegisterPropertyCacheCleanup();
+
+		FSpawnPropertyMap& Map = SpawnPropertyMapLUT.FindOrAdd(&Class);
+		if (Map.bBuilt)
+			return Map;
+
+		Map.bBuilt = true;
+		for (TFieldIterator<FProperty> PropIt(&Class); PropIt; ++PropIt)
+		{
+			const FProperty* Property = *PropIt;
+			const bool bIsExposed = Property->HasAnyPropertyFlags(CPF_ExposeOnSpawn);
+			const bool bIsBlueprintWritable = Property->HasAnyPropertyFlags(CPF_BlueprintVisible) && !Property->HasAnyPropertyFlags(CPF_BlueprintReadOnly);
+			if (!bIsExposed && !bIsBlueprintWritable)
+				continue;
+
+			FSpawnPropertyMap::FEntry& Entry = Map.Entries.Add(Property->GetFName());
+			Entry.Property = Property;
+			Entry.Offset = Property->GetOffset_ForInternal();
+
+			const FName SetterName = FindSetterName(*Property);
+			if (!SetterName.IsNone())
+			{
+				Entry.Setter = Class.FindFunctionByName(SetterName);
+				if (!Entry.Setter)
+				{
+					UE_LOG(LogNeatFunctionsRuntime, Warning, TEXT("%s has no setter called %s for %s."), *Class.GetName(), *SetterName.ToString(), *Property->GetName());
+				}
+			}
+		}
+		return Map;
+	}
+
+	// Imports Text into Value, which must be initialized. Object references are only resolved, never loaded, since that would stall the game thread.
+	bool ImportSpawnPropertyValue(const FProperty& Property, const FString& Text, void* Value, UObject* Owner, FString& OutError)
+	{
+		const FObjectPropertyBase* ObjectProp = CastField<FObjectPropertyBase>(&Property);
+		if (ObjectProp && !Property.IsA<FSoftObjectProperty>())
+		{
+			UObject* Object = nullptr;
+			if (!Text.IsEmpty() && Text != TEXT("None"))
+			{
+				Object = FSoftObjectPath(Text).ResolveObject();
+				if (!Object)
+				{
+					OutError = TEXT("The object isn't loaded. Load it before spawning, or use a soft reference.");
+					return false;
+				}
+
+				const FClassProperty* ClassProp = CastField<FClassProperty>(&Property);
+				if (!Object->IsA(ObjectProp->PropertyClass) || (ClassProp && !CastChecked<UClass>(Object)->IsChildOf(ClassProp->MetaClass)))
+				{
+					OutError = TEXT("The object has the wrong type.");
+					return false;
+				}
+			}
+			ObjectProp->SetObjectPropertyValue(Value, Object);
+			return true;
+		}
+
+		TArray<const FStructProperty*> EncounteredStructProps;
+		if (Property.ContainsObjectReference(EncounteredStructProps, EPropertyObjectReferenceType::Strong | EPropertyObjectReferenceType::Weak))
+		{
+			OutError = TEXT("Properties that contain object references can't be set from text, since importing them may load objects.");
+			return false;
+		}
+
+		if (!Property.ImportText_Direct(*Text, Value, Owner, PPF_None))
+		{
+			OutError = TEXT("The text couldn't be imported.");
+			return false;
+		}
+		return true;
+	}
+
+	// Writes the value through the BlueprintSetter or native setter of the property, if it has one.
+	void AssignSpawnPropertyValue(UObject& Object, const FSpawnPropertyMap::FEntry& Entry, const void* Value)
+	{
+		if (Entry.Setter)
+		{
+			const FProperty* SetterParam = Entry.Setter->PropertyLink;
+			if (!SetterParam || !SetterParam->SameType(Entry.Property))
+			{
+				UE_LOG(LogNeatFunctionsRuntime, Warning, TEXT("%s doesn't take a %s as its first parameter."), *Entry.Setter->GetName(), *Entry.Property->GetCPPType());
+				return;
+			}
+
+			uint8* Parms = static_cast<uint8*>(FMemory_Alloca_Aligned(FMath::Max(Entry.Setter->ParmsSize, 1), Entry.Setter->GetMinAlignment()));
+			FMemory::Memzero(Parms, Entry.Setter->ParmsSize);
+			for (TFieldIterator<FProperty> PropIt(Entry.Setter); PropIt && PropIt->HasAnyPropertyFlags(CPF_Parm); ++PropIt)
+			{
+				PropIt->InitializeValue_InContainer(Parms);
+			}
+
+			SetterParam->CopyCompleteValue(SetterParam->ContainerPtrToValuePtr<void>(Parms), Value);
+			Object.ProcessEvent(Entry.Setter, Parms);
+
+			for (TFieldIterator<FProperty> PropIt(Entry.Setter); PropIt && PropIt->HasAnyPropertyFlags(CPF_Parm); ++PropIt)
+			{
+				PropIt->DestroyValue_InContainer(Parms);
+			}
+			return;
+		}
+
+		// Calls the native setter, if the property has one, and copies the value otherwise.
+		Entry.Property->SetValue_InContainer(&Object, Value);
+	}
+}
 
 void UNeatFunctionsStatics::DefaultFinishSpawningActor(AActor* Actor)
 {
@@ -10,3 +441,278 @@ void UNeatFunctionsStatics::DefaultFinishSpawningActor(AActor* Actor)
 		Actor->FinishSpawning(Actor->GetTransform(), true);
 	}
 }
+
+void UNeatFunctionsStatics::DeferredRegisterComponent(UActorComponent* Component)
+{
+	FNeatDeferredComponentRegistration::Get().Defer(Component);
+}
+
+void UNeatFunctionsStatics::FlushDeferredComponentRegistrations()
+{
+	FNeatDeferredComponentRegistration::Get().Flush();
+}
+
+void UNeatFunctionsStatics::AddToNeatCluster(UObject* Object)
+{
+	FNeatObjectClusters::Get().Add(Object);
+}
+
+void UNeatFunctionsStatics::ReleaseNeatCluster(UObject* Owner)
+{
+	FNeatObjectClusters::Get().Release(Owner);
+}
+
+void UNeatFunctionsStatics::LoadNeatClassAsync(UObject* WorldContextObject, TSoftClassPtr<UObject> Class, FLatentActionInfo LatentInfo)
+{
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	if (!World)
+	{
+		// Without a world there's no latent action manager to resume the node from, so load the class right away and continue,
+		// rather than never triggering the output.
+		UE_LOG(LogNeatFunctionsRuntime, Warning, TEXT("The NeatConstructor node in %s has no world, so %s is loaded synchronously."), *GetPathNameSafe(LatentInfo.CallbackTarget), *Class.ToString());
+		Class.LoadSynchronous();
+
+		UObject* CallbackTarget = LatentInfo.CallbackTarget;
+		if (UFunction* ExecutionFunction = CallbackTarget ? CallbackTarget->FindFunction(LatentInfo.ExecutionFunction) : nullptr)
+		{
+			int32 Linkage = LatentInfo.Linkage;
+			CallbackTarget->ProcessEvent(ExecutionFunction, &Linkage);
+		}
+		return;
+	}
+
+	// Every execution should spawn an object, so unlike most latent nodes we don't ignore calls while another one is pending.
+	FLatentActionManager& LatentManager = World->GetLatentActionManager();
+	LatentManager.AddNewAction(LatentInfo.CallbackTarget, LatentInfo.UUID, new FNeatLoadClassAction(Class.ToSoftObjectPath(), LatentInfo));
+}
+
+void UNeatFunctionsStatics::ApplyNeatArchetype(UObject* Object, UObject* Archetype)
+{
+	if (!Object || !Archetype || !Object->IsA(Archetype->GetClass()))
+		return;
+
+	for (const FProperty* Property : GetArchetypeDelta(*Archetype))
+	{
+		Property->CopyCompleteValue_InContainer(Object, Archetype);
+		TRACE_COUNTER_ADD(NeatCopiedBytes, GetValueBytes(*Property, Property->ContainerPtrToValuePtr<void>(Archetype)));
+	}
+}
+
+void UNeatFunctionsStatics::RegisterNeatPersistentBinding(UObject* Owner, UObject* Source, UClass* FunctionClass, FName UnbindFunction)
+{
+	FNeatPersistentBindings::Get().Register(Owner, Source, FunctionClass, UnbindFunction);
+}
+
+int32 UNeatFunctionsStatics::GetNumActiveNeatPersistentBindings()
+{
+	return FNeatPersistentBindings::Get().GetNumActive();
+}
+
+void UNeatFunctionsStatics::ClearNeatMemoizedResults()
+{
+	FNeatMemoizer::Get().Clear();
+}
+
+void UNeatFunctionsStatics::BeginNeatMemoizationBypass()
+{
+	FNeatMemoizer::Get().BeginBypass();
+}
+
+void UNeatFunctionsStatics::EndNeatMemoizationBypass()
+{
+	FNeatMemoizer::Get().EndBypass();
+}
+
+int32 UNeatFunctionsStatics::BeginNeatBatch(UClass* Class, FName FunctionName, bool bParallel)
+{
+	return FNeatBatchCall::BeginPending(Class ? Class->FindFunctionByName(FunctionName) : nullptr, bParallel);
+}
+
+DEFINE_FUNCTION(UNeatFunctionsStatics::execAddNeatBatchInput)
+{
+	P_GET_PROPERTY(FIntProperty, Batch);
+	P_GET_PROPERTY(FNameProperty, ParameterName);
+
+	Stack.MostRecentProperty = nullptr;
+	Stack.MostRecentPropertyAddress = nullptr;
+	Stack.StepCompiledIn<FArrayProperty>(nullptr);
+	const FArrayProperty* ArrayProperty = CastField<FArrayProperty>(Stack.MostRecentProperty);
+	const void* Values = Stack.MostRecentPropertyAddress;
+
+	P_FINISH;
+
+	P_NATIVE_BEGIN;
+	FNeatBatchCall* Pending = FNeatBatchCall::FindPending(Batch);
+	if (ArrayProperty && Pending)
+	{
+		Pending->AddInput(ParameterName, ArrayProperty->Inner, Values);
+	}
+	P_NATIVE_END;
+}
+
+DEFINE_FUNCTION(UNeatFunctionsStatics::execAddNeatBatchOutput)
+{
+	P_GET_PROPERTY(FIntProperty, Batch);
+	P_GET_PROPERTY(FNameProperty, ParameterName);
+
+	Stack.MostRecentProperty = nullptr;
+	Stack.MostRecentPropertyAddress = nullptr;
+	Stack.StepCompiledIn<FArrayProperty>(nullptr);
+	const FArrayProperty* ArrayProperty = CastField<FArrayProperty>(Stack.MostRecentProperty);
+	void* Values = Stack.MostRecentPropertyAddress;
+
+	P_FINISH;
+
+	P_NATIVE_BEGIN;
+	FNeatBatchCall* Pending = FNeatBatchCall::FindPending(Batch);
+	if (ArrayProperty && Pending)
+	{
+		Pending->AddOutput(ParameterName, ArrayProperty->Inner, Values);
+	}
+	P_NATIVE_END;
+}
+
+void UNeatFunctionsStatics::ExecuteNeatBatch(int32 Batch)
+{
+	// Take the batch off the stack before executing it, in case the function starts a batch of its own.
+	TOptional<FNeatBatchCall> Pending = FNeatBatchCall::TakePending(Batch);
+	if (Pending.IsSet())
+	{
+		Pending->Execute();
+	}
+}
+
+void UNeatFunctionsStatics::NeatProfilerBeginSample(FGuid NodeGuid)
+{
+	FNeatFunctionsProfiler::Get().BeginSample(NodeGuid);
+}
+
+void UNeatFunctionsStatics::NeatProfilerEndSample(FGuid NodeGuid)
+{
+	FNeatFunctionsProfiler::Get().EndSample(NodeGuid);
+}
+
+void UNeatFunctionsStatics::NeatRecordConstruction(FGuid NodeGuid, FName Function, UObject* Object)
+{
+	FNeatRecorder::Get().RecordConstruction(NodeGuid, Function, Object ? Object->GetClass() : nullptr);
+}
+
+void UNeatFunctionsStatics::NeatRecordDelegateFire(FGuid NodeGuid, FName Function, int32 PayloadSize)
+{
+	FNeatRecorder::Get().RecordDelegateFire(NodeGuid, Function, PayloadSize);
+}
+
+DEFINE_FUNCTION(UNeatFunctionsStatics::execNeatMoveIntoProperty)
+{
+	P_GET_OBJECT(UObject, Object);
+	P_GET_PROPERTY(FNameProperty, PropertyName);
+
+	Stack.MostRecentProperty = nullptr;
+	Stack.MostRecentPropertyAddress = nullptr;
+	Stack.StepCompiledIn<FProperty>(nullptr);
+	const FProperty* ValueProperty = Stack.MostRecentProperty;
+	void* Value = Stack.MostRecentPropertyAddress;
+
+	P_FINISH;
+
+	P_NATIVE_BEGIN;
+	MoveIntoProperty(Object, PropertyName, ValueProperty, Value);
+	P_NATIVE_END;
+}
+
+void UNeatFunctionsStatics::MoveIntoProperty(UObject* Object, FName PropertyName, const FProperty* ValueProperty, void* Value)
+{
+	if (!Object || !ValueProperty || !Value)
+		return;
+
+	const FSpawnPropertyMap::FEntry* Entry = GetSpawnPropertyMap(*Object->GetClass()).Entries.Find(PropertyName);
+	if (!Entry || !Entry->Property->SameType(ValueProperty))
+	{
+		UE_LOG(LogNeatFunctionsRuntime, Warning, TEXT("%s has no property called %s of type %s."), *GetNameSafe(Object->GetClass()), *PropertyName.ToString(), *ValueProperty->GetCPPType());
+		return;
+	}
+
+	uint8* PropertyValue = reinterpret_cast<uint8*>(Object) + Entry->Offset;
+	if (!CanMoveProperty(*Entry->Property))
+	{
+		// Only happens if the property changed type since the Blueprint was compiled.
+		Entry->Property->CopyCompleteValue(PropertyValue, Value);
+		TRACE_COUNTER_ADD(NeatCopiedBytes, GetValueBytes(*Entry->Property, PropertyValue));
+		return;
+	}
+
+	// Containers and strings are bitwise relocatable, so swapping the memory hands the heap allocations of the temporary over to the property.
+	// The temporary ends up with the previous value of the property, and is destroyed or overwritten like any other temporary.
+	FMemory::Memswap(PropertyValue, Value, Entry->Property->GetSize());
+
+	TRACE_COUNTER_ADD(NeatMovedBytes, GetValueBytes(*Entry->Property, PropertyValue));
+}
+
+bool UNeatFunctionsStatics::CanMoveProperty(const FProperty& Property)
+{
+	return Property.IsA<FArrayProperty>() || Property.IsA<FMapProperty>() || Property.IsA<FSetProperty>() || Property.IsA<FStrProperty>();
+}
+
+void UNeatFunctionsStatics::NeatCountCopiedBytes(UObject* Object, FName PropertyName)
+{
+#if COUNTERSTRACE_ENABLED
+	if (!Object)
+		return;
+
+	if (const FSpawnPropertyMap::FEntry* Entry = GetSpawnPropertyMap(*Object->GetClass()).Entries.Find(PropertyName))
+	{
+		TRACE_COUNTER_ADD(NeatCopiedBytes, GetValueBytes(*Entry->Property, reinterpret_cast<const uint8*>(Object) + Entry->Offset));
+	}
+#endif
+}
+
+void UNeatFunctionsStatics::SetNeatSpawnProperties(UObject* Object, const TMap<FName, FString>& Properties)
+{
+	if (!Object || Properties.Num() == 0)
+		return;
+
+	FSpawnPropertyMap& Map = GetSpawnPropertyMap(*Object->GetClass());
+	for (const TPair<FName, FString>& Pair : Properties)
+	{
+		FSpawnPropertyMap::FEntry* Entry = Map.Entries.Find(Pair.Key);
+		if (!Entry)
+		{
+			UE_LOG(LogNeatFunctionsRuntime, Warning, TEXT("%s has no writable property called %s."), *GetNameSafe(Object->GetClass()), *Pair.Key.ToString());
+			continue;
+		}
+
+		const FProperty* Property = Entry->Property;
+		if (const TArray<uint8, TAlignedHeapAllocator<16>>* Parsed = Entry->ParsedValues.Find(Pair.Value))
+		{
+			AssignSpawnPropertyValue(*Object, *Entry, Parsed->GetData());
+			continue;
+		}
+
+		void* Value = FMemory_Alloca_Aligned(Property->GetSize(), Property->GetMinAlignment());
+		Property->InitializeValue(Value);
+
+		FString Error;
+		if (ImportSpawnPropertyValue(*Property, Pair.Value, Value, Object, Error))
+		{
+			AssignSpawnPropertyValue(*Object, *Entry, Value);
+
+			// Object references are resolved every time, since a cached pointer would be invisible to the garbage collector.
+			const bool bCanCache = Property->HasAnyPropertyFlags(CPF_IsPlainOldData) && !Property->IsA<FObjectPropertyBase>();
+			if (bCanCache && Entry->ParsedValues.Num() < MaxParsedValuesPerProperty)
+			{
+				Entry->ParsedValues.Add(Pair.Value).Append(static_cast<const uint8*>(Value), Property->GetSize());
+			}
+		}
+		else
+		{
+			UE_LOG(LogNeatFunctionsRuntime, Warning, TEXT("Failed to assign \"%s\" to %s.%s. %s"), *Pair.Value, *GetNameSafe(Object->GetClass()), *Pair.Key.ToString(), *Error);
+		}
+
+		Property->DestroyValue(Value);
+	}
+}
+
+void UNeatFunctionsStatics::QueueCoalescedDispatch(const FNeatCoalescedDispatch& Dispatch)
+{
+	FNeatDelegateCoalescer::Get().Queue(Dispatch);
+}
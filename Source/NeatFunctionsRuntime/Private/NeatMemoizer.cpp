@@ -0,0 +1,450 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#include "NeatMemoizer.h"
+#include "NeatFunctionsRuntimeSettings.h"
+#include "NeatFunctionsStats.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/DelayedAutoRegister.h"
+#include "UObject/UObjectIterator.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogNeatMemoizer, Log, All);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Memoized Hits"), STAT_NeatMemoizedHits, STATGROUP_NeatFunctions);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Memoized Misses"), STAT_NeatMemoizedMisses, STATGROUP_NeatFunctions);
+DECLARE_MEMORY_STAT(TEXT("Memoized Results"), STAT_NeatMemoizedMemory, STATGROUP_NeatFunctions);
+
+namespace
+{
+	// Parameters passed by value or by const reference.
+	bool IsInput(const FProperty* Param)
+	{
+		return !Param->HasAnyPropertyFlags(CPF_OutParm | CPF_ReturnParm) || Param->HasAllPropertyFlags(CPF_ReferenceParm | CPF_ConstParm);
+	}
+
+	// Functions are memoized once every module that could declare them has been loaded.
+	FDelayedAutoRegisterHelper MemoizeTaggedFunctionsHelper(EDelayedRegisterRunPhase::EndOfEngineInit, []()
+	{
+		FNeatMemoizer::Get().MemoizeTaggedFunctions();
+	});
+
+	FAutoConsoleCommand ReportCommand(
+		TEXT("NeatFunctions.Memoize.Report"),
+		TEXT("Prints the hit ratio and memory use of the cache of every memoized function."),
+		FConsoleCommandWithOutputDeviceDelegate::CreateLambda([](FOutputDevice& Ar)
+		{
+			FNeatMemoizer::Get().Report(Ar);
+		}));
+
+	FAutoConsoleCommand ClearCommand(
+		TEXT("NeatFunctions.Memoize.Clear"),
+		TEXT("Drops all memoized results."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			FNeatMemoizer::Get().Clear();
+		}));
+}
+
+FNeatMemoizer& FNeatMemoizer::Get()
+{
+	static FNeatMemoizer Inst;
+	return Inst;
+}
+
+void FNeatMemoizer::MemoizeTaggedFunctions()
+{
+	for (const FString& Path : GetDefault<UNeatFunctionsRuntimeSettings>()->MemoizedFunctions)
+	{
+		if (UFunction* Function = FindObject<UFunction>(nullptr, *Path))
+		{
+			Memoize(Function);
+		}
+		else
+		{
+			UE_LOG(LogNeatMemoizer, Warning, TEXT("Couldn't find the memoized function %s."), *Path);
+		}
+	}
+
+#if WITH_EDITORONLY_DATA
+	for (UFunction* Function : TObjectRange<UFunction>())
+	{
+		if (Function && Function->HasMetaData(MemoizeMetadataName))
+		{
+			Memoize(Function);
+		}
+	}
+#endif
+}
+
+#if WITH_EDITOR
+TArray<FString> FNeatMemoizer::FindTaggedFunctionPaths()
+{
+	TArray<FString> Paths;
+	for (const UFunction* Function : TObjectRange<UFunction>())
+	{
+		if (!Function || !Function->HasAnyFunctionFlags(FUNC_Native) || !Function->HasMetaData(MemoizeMetadataName))
+			continue;
+
+		// Functions of editor modules don't exist in packaged builds, and would only produce warnings there.
+		if (Function->GetPackage()->HasAnyPackageFlags(PKG_EditorOnly | PKG_UncookedOnly))
+			continue;
+
+		Paths.Add(Function->GetPathName());
+	}
+	Paths.Sort();
+	return Paths;
+}
+#endif
+
+bool FNeatMemoizer::CanMemoize(const UFunction* Function, FString* OutReason)
+{
+	const auto Fail = [OutReason](FString&& Reason)
+	{
+		if (OutReason)
+		{
+			*OutReason = MoveTemp(Reason);
+		}
+		return false;
+	};
+
+	if (!Function)
+		return Fail(TEXT("The function doesn't exist."));
+
+	// Blueprint functions don't have a native thunk to replace.
+	if (!Function->HasAnyFunctionFlags(FUNC_Native) || !Function->GetNativeFunc())
+		return Fail(TEXT("Only native functions can be memoized."));
+
+	if (!Function->HasAnyFunctionFlags(FUNC_BlueprintPure))
+		return Fail(TEXT("Only pure functions can be memoized."));
+
+	for (TFieldIterator<FProperty> PropIt(Function); PropIt && PropIt->HasAnyPropertyFlags(CPF_Parm); ++PropIt)
+	{
+		if (PropIt->HasAnyPropertyFlags(CPF_ReferenceParm) && !PropIt->HasAnyPropertyFlags(CPF_ConstParm))
+			return Fail(FString::Printf(TEXT("%s is passed by non-const reference."), *PropIt->GetName()));
+
+		if (IsInput(*PropIt) && !PropIt->HasAnyPropertyFlags(CPF_HasGetValueTypeHash))
+			return Fail(FString::Printf(TEXT("%s can't be hashed."), *PropIt->GetName()));
+	}
+
+	return true;
+}
+
+bool FNeatMemoizer::Memoize(UFunction* Function)
+{
+	check(IsInGameThread());
+
+	if (Function && Caches.ContainsByPredicate([Function](const FFunctionCache& Cache) { return Cache.Function == Function; }))
+		return true;
+
+	FString Reason;
+	if (!CanMemoize(Function, &Reason))
+	{
+		UE_LOG(LogNeatMemoizer, Warning, TEXT("%s can't be memoized. %s"), *GetPathNameSafe(Function), *Reason);
+		return false;
+	}
+
+	if (Caches.Num() >= MaxMemoizedFunctions)
+	{
+		UE_LOG(LogNeatMemoizer, Warning, TEXT("%s can't be memoized. Only %d functions can be memoized."), *GetPathNameSafe(Function), MaxMemoizedFunctions);
+		return false;
+	}
+
+	// The thunks hold on to their cache while calling the original function, so the array must never reallocate.
+	Caches.Reserve(MaxMemoizedFunctions);
+
+	const int32 Slot = Caches.Num();
+	FFunctionCache& Cache = Caches.AddDefaulted_GetRef();
+	Cache.Function = Function;
+	Cache.OriginalFunc = Function->GetNativeFunc();
+	Function->SetNativeFunc(GetThunks(TMakeIntegerSequence<int32, MaxMemoizedFunctions>())[Slot]);
+
+	// Cached results aren't seen by the garbage collector, so they must not outlive a collection.
+	if (!PreGarbageCollectHandle.IsValid())
+	{
+		PreGarbageCollectHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddRaw(this, &FNeatMemoizer::Clear);
+		EndFrameHandle = FCoreDelegates::OnEndFrame.AddLambda([this]()
+		{
+			BypassDepth = 0;
+		});
+	}
+
+	return true;
+}
+
+template <int32 Slot>
+void FNeatMemoizer::execMemoized(UObject* Context, FFrame& Stack, RESULT_DECL)
+{
+	FNeatMemoizer& Memoizer = Get();
+	Memoizer.CallMemoized(Memoizer.Caches[Slot], Context, Stack, RESULT_PARAM);
+}
+
+template <int32... Slots>
+const FNativeFuncPtr* FNeatMemoizer::GetThunks(TIntegerSequence<int32, Slots...>)
+{
+	static const FNativeFuncPtr Thunks[] = { &FNeatMemoizer::execMemoized<Slots>... };
+	return Thunks;
+}
+
+void FNeatMemoizer::CallMemoized(FFunctionCache& Cache, UObject* Context, FFrame& Stack, RESULT_DECL)
+{
+	UFunction* Function = Cache.Function;
+
+	// The cache isn't thread-safe, and pure functions can be called from worker threads, e.g. by thread-safe Animation Blueprints.
+	// Calls through ProcessEvent get a frame of their own, rather than the frame of the calling script. Those come from native code, delegates or RPCs,
+	// which expect the function to run.
+	if (!IsInGameThread() || Stack.Node == Function || BypassDepth > 0)
+	{
+		Cache.OriginalFunc(Context, Stack, RESULT_PARAM);
+		return;
+	}
+
+	// Read the arguments into a parameter struct of our own, like ProcessEvent would, so they can be hashed and cached.
+	uint8* Parms = static_cast<uint8*>(FMemory_Alloca_Aligned(FMath::Max(Function->ParmsSize, 1), Function->GetMinAlignment()));
+	FMemory::Memzero(Parms, Function->ParmsSize);
+
+	const FProperty* ReturnProp = nullptr;
+	TArray<TPair<const FProperty*, void*>, TInlineAllocator<4>> CallerOutputs;
+	TArray<FOutParmRec, TInlineAllocator<4>> OutParms;
+	for (TFieldIterator<FProperty> PropIt(Function); PropIt && PropIt->HasAnyPropertyFlags(CPF_Parm); ++PropIt)
+	{
+		FProperty* Param = *PropIt;
+		Param->InitializeValue_InContainer(Parms);
+		void* ParamAddr = Param->ContainerPtrToValuePtr<void>(Parms);
+
+		if (Param->HasAnyPropertyFlags(CPF_ReturnParm))
+		{
+			ReturnProp = Param;
+		}
+		else if (IsInput(Param) && Param->HasAnyPropertyFlags(CPF_ReferenceParm))
+		{
+			// Const references are copied, since the cached entry has to own its inputs. The original thunk reads them through the out parameter records.
+			const uint8& Value = Stack.StepCompiledInRef<FProperty, uint8>(ParamAddr);
+			if (&Value != ParamAddr)
+			{
+				Param->CopyCompleteValue(ParamAddr, &Value);
+			}
+
+			FOutParmRec& Out = OutParms.AddDefaulted_GetRef();
+			Out.Property = Param;
+			Out.PropAddr = static_cast<uint8*>(ParamAddr);
+		}
+		else if (Param->HasAnyPropertyFlags(CPF_OutParm))
+		{
+			CallerOutputs.Emplace(Param, &Stack.StepCompiledInRef<FProperty, uint8>(ParamAddr));
+
+			FOutParmRec& Out = OutParms.AddDefaulted_GetRef();
+			Out.Property = Param;
+			Out.PropAddr = static_cast<uint8*>(ParamAddr);
+		}
+		else
+		{
+			Stack.StepCompiledIn<FProperty>(ParamAddr);
+		}
+	}
+	P_FINISH;
+
+	// Static functions are called on whichever object the calling script runs on, which doesn't change their results.
+	const UObject* KeyContext = Function->HasAnyFunctionFlags(FUNC_Static) ? nullptr : Context;
+
+	const uint32 Hash = HashInputs(Function, KeyContext, Parms);
+	PurgeExpired(Function, Cache);
+
+	const FObjectKey ContextKey(KeyContext);
+	const FEntry* Hit = Cache.Entries.FindByPredicate([&](const FEntry& Entry)
+	{
+		return Entry.Hash == Hash && Entry.Context == ContextKey && InputsMatch(Function, Entry.Parms, Parms);
+	});
+
+	const uint8* Results = Parms;
+	if (Hit)
+	{
+		Cache.NumHits++;
+		INC_DWORD_STAT(STAT_NeatMemoizedHits);
+		Results = Hit->Parms;
+	}
+	else
+	{
+		Cache.NumMisses++;
+		INC_DWORD_STAT(STAT_NeatMemoizedMisses);
+
+		FFrame NewStack(Context, Function, Parms, &Stack, Function->ChildProperties);
+		for (int32 Index = 0; Index < OutParms.Num(); ++Index)
+		{
+			OutParms[Index].NextOutParm = OutParms.IsValidIndex(Index + 1) ? &OutParms[Index + 1] : nullptr;
+		}
+		NewStack.OutParms = OutParms.Num() > 0 ? OutParms.GetData() : nullptr;
+		NewStack.CurrentNativeFunction = Function;
+
+		Cache.OriginalFunc(Context, NewStack, ReturnProp ? ReturnProp->ContainerPtrToValuePtr<uint8>(Parms) : nullptr);
+
+		// The entry is copied from the parameters, so Results can keep pointing at them.
+		AddEntry(Function, Cache, Hash, KeyContext, Parms);
+	}
+
+	if (ReturnProp && RESULT_PARAM)
+	{
+		ReturnProp->CopyCompleteValue(RESULT_PARAM, ReturnProp->ContainerPtrToValuePtr<void>(Results));
+	}
+	for (const TPair<const FProperty*, void*>& Output : CallerOutputs)
+	{
+		Output.Key->CopyCompleteValue(Output.Value, Output.Key->ContainerPtrToValuePtr<void>(Results));
+	}
+
+	for (TFieldIterator<FProperty> PropIt(Function); PropIt && PropIt->HasAnyPropertyFlags(CPF_Parm); ++PropIt)
+	{
+		PropIt->DestroyValue_InContainer(Parms);
+	}
+}
+
+uint32 FNeatMemoizer::HashInputs(const UFunction* Function, const UObject* Context, const uint8* Parms)
+{
+	// Member functions are cached per object. Context is null for static functions.
+	uint32 Hash = GetTypeHash(FObjectKey(Context));
+	for (TFieldIterator<FProperty> PropIt(Function); PropIt && PropIt->HasAnyPropertyFlags(CPF_Parm); ++PropIt)
+	{
+		if (IsInput(*PropIt))
+		{
+			Hash = HashCombine(Hash, PropIt->GetValueTypeHash(PropIt->ContainerPtrToValuePtr<void>(Parms)));
+		}
+	}
+	return Hash;
+}
+
+bool FNeatMemoizer::InputsMatch(const UFunction* Function, const uint8* A, const uint8* B)
+{
+	for (TFieldIterator<FProperty> PropIt(Function); PropIt && PropIt->HasAnyPropertyFlags(CPF_Parm); ++PropIt)
+	{
+		if (IsInput(*PropIt) && !PropIt->Identical_InContainer(A, B))
+			return false;
+	}
+	return true;
+}
+
+void FNeatMemoizer::PurgeExpired(const UFunction* Function, FFunctionCache& Cache)
+{
+	if (Cache.LastPurgeFrame == GFrameCounter)
+		return;
+
+	Cache.LastPurgeFrame = GFrameCounter;
+
+	const uint64 ScopeFrames = FMath::Max(GetDefault<UNeatFunctionsRuntimeSettings>()->MemoizeScopeFrames, 1);
+	for (int32 Index = Cache.Entries.Num() - 1; Index >= 0; --Index)
+	{
+		if (GFrameCounter - Cache.Entries[Index].Frame >= ScopeFrames)
+		{
+			FreeEntry(Function, Cache.Entries[Index]);
+			Cache.Entries.RemoveAtSwap(Index);
+		}
+	}
+	Cache.NextReplacedEntry = 0;
+}
+
+void FNeatMemoizer::AddEntry(const UFunction* Function, FFunctionCache& Cache, uint32 Hash, const UObject* Context, const uint8* Parms)
+{
+	FEntry* Entry = nullptr;
+	if (Cache.Entries.Num() < FMath::Max(GetDefault<UNeatFunctionsRuntimeSettings>()->MaxMemoizedEntriesPerFunction, 1))
+	{
+		Entry = &Cache.Entries.AddDefaulted_GetRef();
+		Entry->Parms = static_cast<uint8*>(FMemory::Malloc(FMath::Max(Function->ParmsSize, 1), Function->GetMinAlignment()));
+		FMemory::Memzero(Entry->Parms, Function->ParmsSize);
+		for (TFieldIterator<FProperty> PropIt(Function); PropIt && PropIt->HasAnyPropertyFlags(CPF_Parm); ++PropIt)
+		{
+			PropIt->InitializeValue_InContainer(Entry->Parms);
+		}
+
+		MemoryBytes += Function->ParmsSize;
+		SET_MEMORY_STAT(STAT_NeatMemoizedMemory, MemoryBytes);
+	}
+	else
+	{
+		// Entries are replaced in the order they were added, which is also roughly the order they were last computed in.
+		Cache.NextReplacedEntry %= Cache.Entries.Num();
+		Entry = &Cache.Entries[Cache.NextReplacedEntry++];
+	}
+
+	Entry->Hash = Hash;
+	Entry->Context = FObjectKey(Context);
+	Entry->Frame = GFrameCounter;
+	for (TFieldIterator<FProperty> PropIt(Function); PropIt && PropIt->HasAnyPropertyFlags(CPF_Parm); ++PropIt)
+	{
+		PropIt->CopyCompleteValue_InContainer(Entry->Parms, Parms);
+	}
+}
+
+void FNeatMemoizer::FreeEntry(const UFunction* Function, FEntry& Entry)
+{
+	for (TFieldIterator<FProperty> PropIt(Function); PropIt && PropIt->HasAnyPropertyFlags(CPF_Parm); ++PropIt)
+	{
+		PropIt->DestroyValue_InContainer(Entry.Parms);
+	}
+	FMemory::Free(Entry.Parms);
+	Entry.Parms = nullptr;
+
+	MemoryBytes -= Function->ParmsSize;
+	SET_MEMORY_STAT(STAT_NeatMemoizedMemory, MemoryBytes);
+}
+
+void FNeatMemoizer::Clear()
+{
+	for (FFunctionCache& Cache : Caches)
+	{
+		for (FEntry& Entry : Cache.Entries)
+		{
+			FreeEntry(Cache.Function, Entry);
+		}
+		Cache.Entries.Reset();
+		Cache.NextReplacedEntry = 0;
+	}
+}
+
+void FNeatMemoizer::BeginBypass()
+{
+	check(IsInGameThread());
+	BypassDepth++;
+}
+
+void FNeatMemoizer::EndBypass()
+{
+	check(IsInGameThread());
+	BypassDepth = FMath::Max(BypassDepth - 1, 0);
+}
+
+uint64 FNeatMemoizer::GetNumHits() const
+{
+	uint64 NumHits = 0;
+	for (const FFunctionCache& Cache : Caches)
+	{
+		NumHits += Cache.NumHits;
+	}
+	return NumHits;
+}
+
+uint64 FNeatMemoizer::GetNumMisses() const
+{
+	uint64 NumMisses = 0;
+	for (const FFunctionCache& Cache : Caches)
+	{
+		NumMisses += Cache.NumMisses;
+	}
+	return NumMisses;
+}
+
+void FNeatMemoizer::Report(FOutputDevice& Ar) const
+{
+	const auto GetHitRatio = [](uint64 NumHits, uint64 NumMisses)
+	{
+		return NumHits + NumMisses > 0 ? 100.0 * NumHits / (NumHits + NumMisses) : 0.0;
+	};
+
+	for (const FFunctionCache& Cache : Caches)
+	{
+		Ar.Logf(TEXT("%s: %llu hits, %llu misses (%.1f%% hit ratio), %d cached results using %d bytes."),
+			*Cache.Function->GetPathName(), Cache.NumHits, Cache.NumMisses, GetHitRatio(Cache.NumHits, Cache.NumMisses),
+			Cache.Entries.Num(), Cache.Entries.Num() * Cache.Function->ParmsSize);
+	}
+
+	const uint64 NumHits = GetNumHits();
+	const uint64 NumMisses = GetNumMisses();
+	Ar.Logf(TEXT("%d memoized functions: %llu hits, %llu misses (%.1f%% hit ratio), %.1f KiB of cached results."),
+		Caches.Num(), NumHits, NumMisses, GetHitRatio(NumHits, NumMisses), MemoryBytes / 1024.0);
+}
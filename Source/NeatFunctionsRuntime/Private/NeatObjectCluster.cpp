@@ -0,0 +1,195 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#include "NeatObjectCluster.h"
+#include "NeatFunctionsStats.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectClusters.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogNeatObjectCluster, Log, All);
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Object Clusters"), STAT_NeatObjectClusters, STATGROUP_NeatFunctions);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Clustered Objects"), STAT_NeatClusteredObjects, STATGROUP_NeatFunctions);
+
+namespace
+{
+	bool AreClustersEnabled()
+	{
+		static const IConsoleVariable* CVarCreateGCClusters = IConsoleManager::Get().FindConsoleVariable(TEXT("gc.CreateGCClusters"));
+		return CVarCreateGCClusters && CVarCreateGCClusters->GetBool();
+	}
+
+	struct FBenchmarkReferencer : public FGCObject
+	{
+		TArray<TObjectPtr<UObject>> Objects;
+
+		virtual void AddReferencedObjects(FReferenceCollector& Collector) override { Collector.AddReferencedObjects(Objects); }
+		virtual FString GetReferencerName() const override { return TEXT("FBenchmarkReferencer"); }
+	};
+
+	double TimeGarbageCollection()
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS, true);
+		return FPlatformTime::Seconds() - StartTime;
+	}
+
+	// Can be run headless, e.g. `UnrealEditor-Cmd Project -game -nullrhi -ExecCmds="NeatFunctions.BenchmarkClusters 100000, Quit"`.
+	FAutoConsoleCommand BenchmarkCommand(
+		TEXT("NeatFunctions.BenchmarkClusters"),
+		TEXT("Measures a full garbage collection with a number of objects (default 100000) kept alive individually, and then in a Neat object cluster."),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			// Add() does nothing without clusters, so both measurements would be of the same unclustered objects.
+			if (!AreClustersEnabled())
+			{
+				UE_LOG(LogNeatObjectCluster, Error, TEXT("Object clusters are disabled. Set gc.CreateGCClusters to 1 to benchmark them."));
+				return;
+			}
+
+			const int32 Count = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100000;
+
+			FBenchmarkReferencer Referencer;
+			Referencer.Objects.Reserve(Count);
+			for (int32 Index = 0; Index < Count; ++Index)
+			{
+				Referencer.Objects.Add(NewObject<UObject>(GetTransientPackage()));
+			}
+
+			TimeGarbageCollection();
+			const double UnclusteredSeconds = TimeGarbageCollection();
+
+			UNeatObjectCluster* Cluster = NewObject<UNeatObjectCluster>(GetTransientPackage());
+			Cluster->AddToRoot();
+			for (UObject* Object : Referencer.Objects)
+			{
+				Cluster->Add(Object);
+			}
+			Referencer.Objects.Reset();
+
+			TimeGarbageCollection();
+			const double ClusteredSeconds = TimeGarbageCollection();
+
+			Cluster->Release();
+			Cluster->RemoveFromRoot();
+
+			UE_LOG(LogNeatObjectCluster, Display, TEXT("Garbage collection with %d objects: %.2f ms unclustered, %.2f ms clustered (%.2f ms saved)."),
+				Count, UnclusteredSeconds * 1000.0, ClusteredSeconds * 1000.0, (UnclusteredSeconds - ClusteredSeconds) * 1000.0);
+		}));
+}
+
+bool UNeatObjectCluster::Add(UObject* Object)
+{
+	check(IsInGameThread());
+
+	if (!Object || Object == this)
+		return false;
+
+	Objects.Add(Object);
+	INC_DWORD_STAT(STAT_NeatClusteredObjects);
+
+	if (!AreClustersEnabled() || !Object->CanBeInCluster() || Object->GetOwnerIndex() != 0)
+		return false;
+
+	// The engine builds a cluster from whatever the root references at the time, so the first object creates it and the rest are added to it.
+	if (!HasAnyInternalFlags(EInternalObjectFlags::ClusterRoot))
+	{
+		CreateCluster();
+		return HasAnyInternalFlags(EInternalObjectFlags::ClusterRoot);
+	}
+
+	Object->AddToCluster(this);
+	return true;
+}
+
+void UNeatObjectCluster::Release()
+{
+	check(IsInGameThread());
+
+	if (HasAnyInternalFlags(EInternalObjectFlags::ClusterRoot))
+	{
+		GUObjectClusters.DissolveCluster(this);
+	}
+
+	DEC_DWORD_STAT_BY(STAT_NeatClusteredObjects, Objects.Num());
+	Objects.Reset();
+}
+
+FNeatObjectClusters& FNeatObjectClusters::Get()
+{
+	static FNeatObjectClusters Inst;
+	return Inst;
+}
+
+void FNeatObjectClusters::Add(UObject* Object)
+{
+	check(IsInGameThread());
+
+	if (!Object)
+		return;
+
+	const UObject* Owner = Object->GetOuter();
+	FEntry& Entry = Clusters.FindOrAdd(Owner);
+	if (!Entry.Cluster.IsValid())
+	{
+		Entry.Cluster = NewObject<UNeatObjectCluster>(GetTransientPackage());
+		Entry.NumObjects = 0;
+		INC_DWORD_STAT(STAT_NeatObjectClusters);
+	}
+
+	if (!PreGarbageCollectHandle.IsValid())
+	{
+		PreGarbageCollectHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddRaw(this, &FNeatObjectClusters::ReleaseStale);
+	}
+
+	Entry.NumObjects++;
+	if (!Entry.Cluster->Add(Object))
+	{
+		UE_LOG(LogNeatObjectCluster, Verbose, TEXT("%s can't be added to a GC cluster. It will be kept alive as long as the cluster of %s is."), *GetNameSafe(Object), *GetNameSafe(Owner));
+	}
+}
+
+void FNeatObjectClusters::Release(const UObject* Owner)
+{
+	check(IsInGameThread());
+
+	FEntry Entry;
+	if (Clusters.RemoveAndCopyValue(Owner, Entry))
+	{
+		ReleaseEntry(Entry);
+	}
+}
+
+UNeatObjectCluster* FNeatObjectClusters::Find(const UObject* Owner) const
+{
+	const FEntry* Entry = Clusters.Find(Owner);
+	return Entry ? Entry->Cluster.Get() : nullptr;
+}
+
+void FNeatObjectClusters::ReleaseEntry(const FEntry& Entry)
+{
+	if (UNeatObjectCluster* Cluster = Entry.Cluster.Get())
+	{
+		Cluster->Release();
+	}
+	else
+	{
+		DEC_DWORD_STAT_BY(STAT_NeatClusteredObjects, Entry.NumObjects);
+	}
+	DEC_DWORD_STAT(STAT_NeatObjectClusters);
+}
+
+void FNeatObjectClusters::ReleaseStale()
+{
+	// Destroyed actors are marked as garbage, so their clusters are dissolved before the collection rather than kept intact until nothing references them.
+	// Clusters that were collected because none of their objects were referenced anymore are just forgotten.
+	for (auto It = Clusters.CreateIterator(); It; ++It)
+	{
+		const UObject* Owner = It.Key().Get();
+		if (!IsValid(Owner) || !It.Value().Cluster.IsValid())
+		{
+			ReleaseEntry(It.Value());
+			It.RemoveCurrent();
+		}
+	}
+}
@@ -0,0 +1,115 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#include "NeatPersistentBindings.h"
+#include "NeatFunctionsStats.h"
+#include "Engine/World.h"
+#include "Misc/CoreDelegates.h"
+#include "UObject/UObjectGlobals.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Active Persistent Bindings"), STAT_NeatActivePersistentBindings, STATGROUP_NeatFunctions);
+
+DEFINE_LOG_CATEGORY_STATIC(LogNeatPersistentBindings, Log, All);
+
+FNeatPersistentBindings& FNeatPersistentBindings::Get()
+{
+	static FNeatPersistentBindings Inst;
+	return Inst;
+}
+
+void FNeatPersistentBindings::Register(const UObject* Owner, UObject* Source, const UClass* FunctionClass, FName UnbindFunction)
+{
+	check(IsInGameThread());
+
+	if (!Owner || !FunctionClass)
+		return;
+
+	Bindings.Add({ Owner, Source, FunctionClass, UnbindFunction });
+	SET_DWORD_STAT(STAT_NeatActivePersistentBindings, Bindings.Num());
+
+	if (!EndFrameHandle.IsValid())
+	{
+		EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FNeatPersistentBindings::UnbindDestroyedOwners);
+		PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddLambda([this](UWorld*, ELevelTick, float)
+		{
+			UnbindDestroyedOwners();
+		});
+		PostGarbageCollectHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddRaw(this, &FNeatPersistentBindings::RemoveCollectedOwners);
+		PreExitHandle = FCoreDelegates::OnPreExit.AddRaw(this, &FNeatPersistentBindings::RemoveDelegates);
+	}
+}
+
+void FNeatPersistentBindings::RemoveDelegates()
+{
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(PostGarbageCollectHandle);
+	FCoreDelegates::OnPreExit.Remove(PreExitHandle);
+
+	EndFrameHandle.Reset();
+	PostActorTickHandle.Reset();
+	PostGarbageCollectHandle.Reset();
+	PreExitHandle.Reset();
+}
+
+int32 FNeatPersistentBindings::GetNumActive()
+{
+	// Destroyed actors are marked as garbage right away, so they're unbound before they're actually collected.
+	UnbindDestroyedOwners();
+	return Bindings.Num();
+}
+
+void FNeatPersistentBindings::UnbindDestroyedOwners()
+{
+	check(IsInGameThread());
+
+	for (int32 Index = Bindings.Num() - 1; Index >= 0; --Index)
+	{
+		if (Bindings[Index].Owner.IsValid())
+			continue;
+
+		// Removed before calling the unbind function, which may register new bindings.
+		const FBinding Binding = Bindings[Index];
+		Bindings.RemoveAtSwap(Index);
+		Unbind(Binding);
+	}
+	SET_DWORD_STAT(STAT_NeatActivePersistentBindings, Bindings.Num());
+}
+
+void FNeatPersistentBindings::RemoveCollectedOwners()
+{
+	// Only forgets the bindings. Nothing is called while garbage is being collected.
+	Bindings.RemoveAllSwap([](const FBinding& Binding) { return !Binding.Owner.Get(true); });
+	SET_DWORD_STAT(STAT_NeatActivePersistentBindings, Bindings.Num());
+}
+
+void FNeatPersistentBindings::Unbind(const FBinding& Binding)
+{
+	// A destroyed owner is garbage, but still reachable until the next garbage collection, so it can still be compared against the bound delegates.
+	// An owner that is already gone can't be passed on, and the delegates bound to it will never fire again anyway.
+	const UObject* Owner = Binding.Owner.Get(true);
+	const UClass* FunctionClass = Binding.FunctionClass.Get();
+	if (!Owner || !FunctionClass)
+		return;
+
+	UFunction* Function = FunctionClass->FindFunctionByName(Binding.UnbindFunction);
+	if (!Function)
+	{
+		UE_LOG(LogNeatPersistentBindings, Warning, TEXT("%s has no function called %s to unbind %s with."), *FunctionClass->GetName(), *Binding.UnbindFunction.ToString(), *Owner->GetName());
+		return;
+	}
+
+	// Nothing left to unbind from, if the source has been destroyed as well.
+	UObject* Target = Function->HasAnyFunctionFlags(FUNC_Static) ? FunctionClass->GetDefaultObject() : Binding.Source.Get();
+	if (!Target)
+		return;
+
+	// Validated at compile time to take a single object parameter.
+	const FObjectPropertyBase* OwnerParam = CastField<FObjectPropertyBase>(Function->PropertyLink);
+	if (!OwnerParam)
+		return;
+
+	TArray<uint8, TInlineAllocator<16>> Params;
+	Params.SetNumZeroed(Function->ParmsSize);
+	OwnerParam->SetObjectPropertyValue_InContainer(Params.GetData(), const_cast<UObject*>(Owner));
+	Target->ProcessEvent(Function, Params.GetData());
+}
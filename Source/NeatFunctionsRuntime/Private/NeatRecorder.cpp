@@ -0,0 +1,274 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#include "NeatRecorder.h"
+#include "NeatFunctionsStats.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogNeatRecorder, Log, All);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Recorded Events"), STAT_NeatRecordedEvents, STATGROUP_NeatFunctions);
+
+namespace
+{
+	constexpr uint32 CaptureMagic = 0x5441454E; // "NEAT"
+	constexpr int32 CaptureVersion = 1;
+	constexpr int64 HeaderSize = sizeof(uint32) + sizeof(int32) + sizeof(int32) + sizeof(uint64);
+	constexpr int32 DefaultCapacity = 64 * 1024;
+
+	FAutoConsoleCommand StartCommand(
+		TEXT("NeatFunctions.Record.Start"),
+		TEXT("Starts recording Neat delegate fires and constructions. Optionally takes a filename and the number of records to keep (default 65536)."),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			const FString Filename = Args.Num() > 0 ? Args[0] : FPaths::ProfilingDir() / TEXT("NeatFunctions.neatrec");
+			const int32 Capacity = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : DefaultCapacity;
+			FNeatRecorder::Get().Start(Filename, Capacity);
+		}));
+
+	FAutoConsoleCommand StopCommand(
+		TEXT("NeatFunctions.Record.Stop"),
+		TEXT("Stops recording Neat delegate fires and constructions."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			FNeatRecorder::Get().Stop();
+		}));
+}
+
+FArchive& operator<<(FArchive& Ar, FNeatRecord& Record)
+{
+	Ar << Record.Timestamp;
+	Ar << Record.Frame;
+	Ar << Record.NodeGuid;
+	Ar << Record.FunctionIndex;
+	Ar << Record.ClassIndex;
+	Ar << Record.PayloadSize;
+	Ar << Record.Type;
+	return Ar;
+}
+
+FNeatRecorder& FNeatRecorder::Get()
+{
+	static FNeatRecorder Inst;
+	return Inst;
+}
+
+bool FNeatRecorder::Start(const FString& Filename, int32 InCapacity)
+{
+	Stop();
+
+	if (InCapacity <= 0)
+	{
+		UE_LOG(LogNeatRecorder, Error, TEXT("A capture must hold at least one record."));
+		return false;
+	}
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(Filename));
+
+	CaptureHandle.Reset(PlatformFile.OpenWrite(*Filename, false, true));
+	NamesHandle.Reset(PlatformFile.OpenWrite(*GetNamesFilename(Filename)));
+	if (!CaptureHandle || !NamesHandle)
+	{
+		UE_LOG(LogNeatRecorder, Error, TEXT("Failed to open %s for recording."), *Filename);
+		CaptureHandle.Reset();
+		NamesHandle.Reset();
+		return false;
+	}
+
+	Capacity = InCapacity;
+	NumWritten = 0;
+	NameIndices.Reset();
+	PendingNames.Reset();
+	PendingRecords.Reset();
+	StartTime = FPlatformTime::Seconds();
+
+	WriteHeader();
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FNeatRecorder::Flush);
+
+	UE_LOG(LogNeatRecorder, Display, TEXT("Recording Neat events to %s, keeping the latest %d."), *Filename, Capacity);
+	return true;
+}
+
+void FNeatRecorder::Stop()
+{
+	if (!IsRecording())
+		return;
+
+	Flush();
+
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+	EndFrameHandle.Reset();
+	CaptureHandle.Reset();
+	NamesHandle.Reset();
+
+	UE_LOG(LogNeatRecorder, Display, TEXT("Stopped recording after %llu Neat events."), NumWritten);
+}
+
+void FNeatRecorder::RecordConstruction(const FGuid& NodeGuid, FName Function, const UClass* Class)
+{
+	if (!IsRecording() || !IsInGameThread())
+		return;
+
+	FNeatRecord& Record = PendingRecords.AddDefaulted_GetRef();
+	Record.Type = ENeatRecordType::Construction;
+	Record.Timestamp = FPlatformTime::Seconds() - StartTime;
+	Record.Frame = GFrameCounter;
+	Record.NodeGuid = NodeGuid;
+	Record.FunctionIndex = GetNameIndex(Function);
+	Record.ClassIndex = Class ? GetNameIndex(FName(Class->GetPathName())) : INDEX_NONE;
+}
+
+void FNeatRecorder::RecordDelegateFire(const FGuid& NodeGuid, FName Function, int32 PayloadSize)
+{
+	if (!IsRecording() || !IsInGameThread())
+		return;
+
+	FNeatRecord& Record = PendingRecords.AddDefaulted_GetRef();
+	Record.Type = ENeatRecordType::DelegateFire;
+	Record.Timestamp = FPlatformTime::Seconds() - StartTime;
+	Record.Frame = GFrameCounter;
+	Record.NodeGuid = NodeGuid;
+	Record.FunctionIndex = GetNameIndex(Function);
+	Record.PayloadSize = FMath::Max(PayloadSize, 0);
+}
+
+int32 FNeatRecorder::GetNameIndex(FName Name)
+{
+	if (const int32* Index = NameIndices.Find(Name))
+		return *Index;
+
+	PendingNames.Add(Name);
+	return NameIndices.Add(Name, NameIndices.Num());
+}
+
+void FNeatRecorder::Flush()
+{
+	if (!IsRecording() || (PendingRecords.Num() == 0 && PendingNames.Num() == 0))
+		return;
+
+	// Names are written before the records referencing them, so a capture cut short by a crash can still be read.
+	if (PendingNames.Num() > 0)
+	{
+		FString Lines;
+		for (FName Name : PendingNames)
+		{
+			Lines += Name.ToString() + TEXT("\n");
+		}
+		PendingNames.Reset();
+
+		const FTCHARToUTF8 Utf8(*Lines);
+		NamesHandle->Write(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+		NamesHandle->Flush();
+	}
+
+	// If more records than fit were made this frame, only the latest ones are kept anyway.
+	const int32 FirstRecord = FMath::Max(PendingRecords.Num() - Capacity, 0);
+	NumWritten += FirstRecord;
+
+	TArray<uint8> Buffer;
+	FMemoryWriter Writer(Buffer);
+	for (int32 Index = FirstRecord; Index < PendingRecords.Num(); ++Index)
+	{
+		Writer << PendingRecords[Index];
+	}
+	check(Buffer.Num() == (PendingRecords.Num() - FirstRecord) * FNeatRecord::SerializedSize);
+
+	// Write the records in contiguous runs, wrapping around at the end of the ring.
+	int32 Offset = 0;
+	while (Offset < Buffer.Num())
+	{
+		const int32 Slot = static_cast<int32>(NumWritten % Capacity);
+		const int32 NumRecords = FMath::Min(Capacity - Slot, (Buffer.Num() - Offset) / FNeatRecord::SerializedSize);
+		const int32 NumBytes = NumRecords * FNeatRecord::SerializedSize;
+
+		CaptureHandle->Seek(HeaderSize + static_cast<int64>(Slot) * FNeatRecord::SerializedSize);
+		CaptureHandle->Write(Buffer.GetData() + Offset, NumBytes);
+
+		Offset += NumBytes;
+		NumWritten += NumRecords;
+	}
+
+	INC_DWORD_STAT_BY(STAT_NeatRecordedEvents, PendingRecords.Num());
+	PendingRecords.Reset();
+
+	WriteHeader();
+	CaptureHandle->Flush();
+}
+
+void FNeatRecorder::WriteHeader()
+{
+	TArray<uint8> Buffer;
+	FMemoryWriter Writer(Buffer);
+
+	uint32 Magic = CaptureMagic;
+	int32 Version = CaptureVersion;
+	Writer << Magic;
+	Writer << Version;
+	Writer << Capacity;
+	Writer << NumWritten;
+
+	CaptureHandle->Seek(0);
+	CaptureHandle->Write(Buffer.GetData(), Buffer.Num());
+}
+
+FString FNeatRecorder::GetNamesFilename(const FString& Filename)
+{
+	return Filename + TEXT(".names");
+}
+
+bool FNeatRecorder::ReadCapture(const FString& Filename, TArray<FNeatRecord>& OutRecords, TArray<FString>& OutNames)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const TUniquePtr<IMappedFileHandle> MappedFile(PlatformFile.OpenMapped(*Filename));
+	const TUniquePtr<IMappedFileRegion> Region(MappedFile ? MappedFile->MapRegion() : nullptr);
+	if (!Region || Region->GetMappedSize() < HeaderSize)
+	{
+		UE_LOG(LogNeatRecorder, Error, TEXT("Failed to read Neat capture from %s."), *Filename);
+		return false;
+	}
+
+	FMemoryReaderView Reader(MakeArrayView(Region->GetMappedPtr(), Region->GetMappedSize()));
+
+	uint32 Magic = 0;
+	int32 Version = 0;
+	int32 FileCapacity = 0;
+	uint64 FileNumWritten = 0;
+	Reader << Magic;
+	Reader << Version;
+	Reader << FileCapacity;
+	Reader << FileNumWritten;
+	if (Magic != CaptureMagic || Version != CaptureVersion || FileCapacity <= 0)
+	{
+		UE_LOG(LogNeatRecorder, Error, TEXT("%s is not a supported Neat capture."), *Filename);
+		return false;
+	}
+
+	const int32 NumRecords = static_cast<int32>(FMath::Min<uint64>(FileNumWritten, FileCapacity));
+	if (Region->GetMappedSize() < HeaderSize + static_cast<int64>(NumRecords) * FNeatRecord::SerializedSize)
+	{
+		UE_LOG(LogNeatRecorder, Error, TEXT("%s is truncated."), *Filename);
+		return false;
+	}
+
+	// Once the ring has wrapped around, the oldest record is the one that would be overwritten next.
+	const int32 OldestSlot = FileNumWritten > static_cast<uint64>(FileCapacity) ? static_cast<int32>(FileNumWritten % FileCapacity) : 0;
+
+	OutRecords.Reset(NumRecords);
+	for (int32 Index = 0; Index < NumRecords; ++Index)
+	{
+		const int32 Slot = (OldestSlot + Index) % FileCapacity;
+		Reader.Seek(HeaderSize + static_cast<int64>(Slot) * FNeatRecord::SerializedSize);
+		Reader << OutRecords.AddDefaulted_GetRef();
+	}
+
+	OutNames.Reset();
+	FFileHelper::LoadFileToStringArray(OutNames, *GetNamesFilename(Filename));
+	return true;
+}
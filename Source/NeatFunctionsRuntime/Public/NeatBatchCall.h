@@ -0,0 +1,60 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Calls a function once per element of its argument arrays, natively, for UK2Node_NeatBatchFunction.
+ * Each input array provides one parameter, and each output array receives one output parameter (or the return value).
+ * An input array with a single element provides the same value to every call.
+ * When the function is thread-safe and native, chunks of elements are processed in parallel.
+ */
+class NEATFUNCTIONSRUNTIME_API FNeatBatchCall
+{
+public:
+	FNeatBatchCall(UFunction* InFunction, bool bInParallel);
+
+	void AddInput(FName ParameterName, const FProperty* ElementProperty, const void* Array);
+	void AddOutput(FName ParameterName, const FProperty* ElementProperty, void* Array);
+
+	// Returns the number of elements processed, which is the length of the shortest input array with more than one element.
+	// Inputs with a single element are passed to every call.
+	int32 Execute();
+
+	// Starts a batch set up by the Blueprint VM on this thread, and returns the handle the script passes to the following calls.
+	// The batched function may itself run Blueprint code that sets up another batch.
+	static int32 BeginPending(UFunction* Function, bool bParallel);
+	static FNeatBatchCall* FindPending(int32 Handle);
+
+	// Removes a pending batch, along with every batch started after it. Those were abandoned by scripts that were aborted before executing them,
+	// since the batched function only runs once the batch has been removed.
+	static TOptional<FNeatBatchCall> TakePending(int32 Handle);
+
+	// Number of elements per parallel task.
+	static constexpr int32 ChunkSize = 256;
+
+private:
+	struct FArgument
+	{
+		const FProperty* Parameter = nullptr;
+		const FProperty* ElementProperty = nullptr;
+		void* Array = nullptr;
+	};
+
+	struct FPendingBatch
+	{
+		int32 Handle;
+		FNeatBatchCall Batch;
+	};
+
+	static TArray<FPendingBatch>& GetPending();
+
+	bool AddArgument(FName ParameterName, const FProperty* ElementProperty, void* Array, TArray<FArgument>& OutArguments);
+	void ExecuteRange(int32 Begin, int32 End) const;
+
+	UFunction* Function = nullptr;
+	bool bParallel = false;
+	TArray<FArgument> Inputs;
+	TArray<FArgument> Outputs;
+};
@@ -0,0 +1,33 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/StreamableManager.h"
+
+/**
+ * Streams in classes for NeatConstructor nodes that take a `TSoftClassPtr`.
+ * Nodes waiting on the same class share a single streaming request, and the time spent waiting is accumulated.
+ */
+class NEATFUNCTIONSRUNTIME_API FNeatClassLoader
+{
+public:
+	static FNeatClassLoader& Get();
+
+	// Returns the in-flight request for the class if there is one, or starts a new one.
+	TSharedPtr<FStreamableHandle> RequestClass(const FSoftObjectPath& ClassPath);
+
+	double GetTotalWaitSeconds() const { return TotalWaitSeconds; }
+	int32 GetNumRequests() const { return NumRequests; }
+	int32 GetNumSharedRequests() const { return NumSharedRequests; }
+
+private:
+	void OnClassLoaded(FSoftObjectPath ClassPath, double StartTime);
+
+	FStreamableManager StreamableManager;
+	TMap<FSoftObjectPath, TWeakPtr<FStreamableHandle>> InFlight;
+
+	double TotalWaitSeconds = 0.0;
+	int32 NumRequests = 0;
+	int32 NumSharedRequests = 0;
+};
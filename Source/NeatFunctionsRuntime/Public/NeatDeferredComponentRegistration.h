@@ -0,0 +1,43 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UActorComponent;
+class UWorld;
+
+/**
+ * Collects components created by NeatConstructor nodes with the "NeatDeferredRegistration" metadata, and registers them together.
+ * Registering many components in one go lets their render state be created in a single batch, rather than once per component.
+ * Pending components are registered after actors have ticked, at the end of the frame, or when Flush() is called, whichever comes first.
+ */
+class NEATFUNCTIONSRUNTIME_API FNeatDeferredComponentRegistration
+{
+public:
+	static FNeatDeferredComponentRegistration& Get();
+
+	void Defer(UActorComponent* Component);
+
+	// Registers all pending components. Pass a world to only register components in that world.
+	void Flush(const UWorld* OnlyWorld = nullptr);
+
+	int32 GetNumPending() const { return Pending.Num(); }
+
+	// Number of deferred registrations that were processed during the previous frame.
+	int32 GetNumRegisteredLastFrame() const { return NumRegisteredLastFrame; }
+
+private:
+	void OnEndFrame();
+	void RemoveDelegates();
+
+	// A set, so deferring a component that is already pending stays cheap however many are pending.
+	TSet<TWeakObjectPtr<UActorComponent>> Pending;
+
+	int32 NumRegisteredThisFrame = 0;
+	int32 NumRegisteredLastFrame = 0;
+
+	FDelegateHandle EndFrameHandle;
+	FDelegateHandle PostActorTickHandle;
+	FDelegateHandle PreExitHandle;
+};
@@ -0,0 +1,54 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "NeatFunctionsStatics.h"
+#include "UObject/ObjectKey.h"
+
+/**
+ * Collapses delegate fires of Neat delegates marked with "NeatCoalesce" into a single dispatch per frame.
+ * Dispatches are executed after the actors of the world owning the target have ticked, or at the end of the frame for objects outside of any world.
+ * The Blueprint side stores the latest payload itself (as the outputs of the event bound to the C++ delegate), so only the
+ * dispatch and the number of fires it stands for are buffered here.
+ */
+class NEATFUNCTIONSRUNTIME_API FNeatDelegateCoalescer
+{
+public:
+	static FNeatDelegateCoalescer& Get();
+
+	void Queue(const FNeatCoalescedDispatch& Dispatch);
+
+	// Executes all pending dispatches. Dispatches queued while flushing are executed during the next flush.
+	void Flush();
+
+	// Executes the pending dispatches of objects in the world. A null world stands for objects outside of any world.
+	void FlushWorld(TObjectKey<UWorld> World);
+
+	// Number of fires during the previous frame that didn't result in a dispatch of their own.
+	int32 GetNumAbsorbedLastFrame() const { return NumAbsorbedLastFrame; }
+	uint64 GetTotalAbsorbed() const { return TotalAbsorbed; }
+
+private:
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	void OnEndFrame();
+	void RemoveDelegates();
+
+	struct FPendingDispatch
+	{
+		FNeatCoalescedDispatch Dispatch;
+		int32 FireCount = 0;
+	};
+
+	using FDispatchMap = TMap<TPair<TObjectKey<UObject>, FName>, FPendingDispatch>;
+	TMap<TObjectKey<UWorld>, FDispatchMap> PendingPerWorld;
+
+	int32 NumAbsorbedThisFrame = 0;
+	int32 NumAbsorbedLastFrame = 0;
+	uint64 TotalAbsorbed = 0;
+
+	FDelegateHandle PostActorTickHandle;
+	FDelegateHandle EndFrameHandle;
+	FDelegateHandle PreExitHandle;
+};
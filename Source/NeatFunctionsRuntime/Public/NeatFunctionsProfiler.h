@@ -0,0 +1,54 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Accumulated runtime cost of a single Neat node call site, identified by the GUID of the node in the graph.
+ */
+struct NEATFUNCTIONSRUNTIME_API FNeatNodeStats
+{
+	uint64 CallCount = 0;
+	double TotalSeconds = 0.0;
+	uint64 FirstFrame = 0;
+	uint64 LastFrame = 0;
+
+	double GetCallsPerFrame() const;
+	double GetAverageMicroseconds() const;
+
+	friend FArchive& operator<<(FArchive& Ar, FNeatNodeStats& Stats);
+};
+
+/**
+ * Samples call counts and time spent in Neat nodes that have been compiled with instrumentation.
+ * Nodes are only instrumented when `NeatFunctions.InstrumentNodes` is enabled while compiling, so nothing is recorded (or paid for) otherwise.
+ * Use `NeatFunctions.Profiling 1` to start sampling, and `NeatFunctions.Profiling.Save`/`NeatFunctions.Profiling.Load` to work with captures.
+ */
+class NEATFUNCTIONSRUNTIME_API FNeatFunctionsProfiler
+{
+public:
+	static FNeatFunctionsProfiler& Get();
+
+	bool IsEnabled() const;
+
+	void BeginSample(const FGuid& NodeGuid);
+	void EndSample(const FGuid& NodeGuid);
+
+	const FNeatNodeStats* FindStats(const FGuid& NodeGuid) const;
+
+	// Total time of the most expensive call site. Used to normalize the heatmap in the graph editor.
+	double GetMaxTotalSeconds() const { return MaxTotalSeconds; }
+
+	void Reset();
+	bool SaveCapture(const FString& Filename) const;
+	bool LoadCapture(const FString& Filename);
+
+private:
+	TMap<FGuid, FNeatNodeStats> Stats;
+
+	// Neat nodes can be nested, since delegates are often executed synchronously by the function they're passed to.
+	TArray<TPair<FGuid, double>, TInlineAllocator<8>> OpenSamples;
+
+	double MaxTotalSeconds = 0.0;
+};
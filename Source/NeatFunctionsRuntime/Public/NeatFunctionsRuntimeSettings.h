@@ -0,0 +1,43 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "NeatFunctionsRuntimeSettings.generated.h"
+
+/**
+ * Project settings for the parts of Neat Functions that run in packaged builds.
+ */
+UCLASS(Config = Game, DefaultConfig, meta = (DisplayName = "Neat Functions Runtime"))
+class NEATFUNCTIONSRUNTIME_API UNeatFunctionsRuntimeSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	virtual FName GetCategoryName() const override { return TEXT("Plugins"); }
+
+	// Paths of the native functions with the "NeatMemoize" metadata. Metadata isn't available in packaged builds, so this list is what they memoize.
+	// The editor warns on startup when it's out of date.
+	UPROPERTY(Config, VisibleAnywhere, Category = "Memoization")
+	TArray<FString> MemoizedFunctions;
+
+#if WITH_EDITOR
+	// Replaces MemoizedFunctions with the functions that currently have the metadata, and saves it to the default config.
+	UFUNCTION(CallInEditor, Category = "Memoization")
+	void RefreshMemoizedFunctions();
+#endif
+
+	// BlueprintSetter of each native property that has one, keyed by the path of the property. Metadata isn't available in packaged builds,
+	// so "NeatSpawnProperties" reads the setters from here. The editor updates it whenever the project is cooked.
+	UPROPERTY(Config, VisibleAnywhere, Category = "Spawn Properties")
+	TMap<FString, FName> PropertySetters;
+
+	// Number of frames a memoized result is served for. 1 means results are only reused within the frame they were computed in.
+	UPROPERTY(Config, EditAnywhere, Category = "Memoization", meta = (ClampMin = 1))
+	int32 MemoizeScopeFrames = 1;
+
+	// Maximum number of distinct inputs cached per memoized function. The oldest results are replaced once it's full.
+	UPROPERTY(Config, EditAnywhere, Category = "Memoization", meta = (ClampMin = 1))
+	int32 MaxMemoizedEntriesPerFunction = 64;
+};
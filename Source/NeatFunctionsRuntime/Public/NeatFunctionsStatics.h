@@ -3,9 +3,15 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Engine/LatentActionManager.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
 #include "NeatFunctionsStatics.generated.h"
 
+class UActorComponent;
+
+// Executed once per frame for coalesced Neat delegates, with the number of times the delegate fired during that frame.
+DECLARE_DYNAMIC_DELEGATE_OneParam(FNeatCoalescedDispatch, int32, FireCount);
+
 /**
  * 
  */
@@ -19,4 +25,112 @@ public:
 	// We don't use UGameplayStatics::FinishSpawningActor() to avoid having to deal with extra pins that aren't required.
 	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
 	static void DefaultFinishSpawningActor(AActor* Actor);
+
+	// Function used internally as the finish function for component NeatConstructors with the "NeatDeferredRegistration" metadata.
+	// Queues the component so it is registered in a batch together with other components created during the same frame.
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
+	static void DeferredRegisterComponent(UActorComponent* Component);
+
+	// Registers all components that are still waiting for a deferred registration.
+	UFUNCTION(BlueprintCallable, Category = "Neat Functions")
+	static void FlushDeferredComponentRegistrations();
+
+	// Function used internally by NeatConstructor nodes with the "NeatClustered" metadata.
+	// Adds the object to the GC cluster of its outer, so the garbage collector doesn't have to mark it individually.
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
+	static void AddToNeatCluster(UObject* Object);
+
+	// Releases the GC cluster holding the objects that were constructed with Owner as their outer by "NeatClustered" constructors.
+	// Until this is called (or Owner is destroyed), every object in the cluster is kept alive as long as any of them is referenced.
+	UFUNCTION(BlueprintCallable, Category = "Neat Functions", meta = (DefaultToSelf = "Owner"))
+	static void ReleaseNeatCluster(UObject* Owner);
+
+	// Function used internally by NeatConstructor nodes whose class parameter is a `TSoftClassPtr`.
+	// Completes once the class has been streamed in, so the spawn function can resolve it without loading synchronously.
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true, Latent, LatentInfo = "LatentInfo", WorldContext = "WorldContextObject"))
+	static void LoadNeatClassAsync(UObject* WorldContextObject, TSoftClassPtr<UObject> Class, FLatentActionInfo LatentInfo);
+
+	// Function used internally when every ExposeOnSpawn value of a NeatConstructor node is known at compile time.
+	// Copies the values baked into the archetype onto the spawned object, instead of running one assignment node per property.
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
+	static void ApplyNeatArchetype(UObject* Object, UObject* Archetype);
+
+	// Function used internally by NeatConstructor nodes for ExposeOnSpawn containers connected to a single-use temporary, such as the result of a pure function.
+	// Swaps the value into the property instead of copying it, which leaves the previous value of the property in the temporary.
+	UFUNCTION(BlueprintCallable, CustomThunk, meta = (BlueprintInternalUseOnly = true, CustomStructureParam = "Value"))
+	static void NeatMoveIntoProperty(UObject* Object, FName PropertyName, UPARAM(ref) int32& Value);
+	DECLARE_FUNCTION(execNeatMoveIntoProperty);
+
+	static void MoveIntoProperty(UObject* Object, FName PropertyName, const FProperty* ValueProperty, void* Value);
+
+	// Whether values of the property can be moved by swapping their memory. Only engine containers and strings are known to be bitwise relocatable.
+	// Native structs may point into themselves, so they are always copied.
+	static bool CanMoveProperty(const FProperty& Property);
+
+	// Function used internally by NeatConstructor nodes after expensive ExposeOnSpawn values have been copied by assignment nodes.
+	// Adds the size of the copied value to the CopiedBytes trace counter. Does nothing when counters are compiled out.
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
+	static void NeatCountCopiedBytes(UObject* Object, FName PropertyName);
+
+	// Function used internally by NeatConstructor nodes with the "NeatSpawnProperties" metadata.
+	// Assigns each value by importing it as text into the property with the matching name, which lets a dynamic class set properties of any subclass.
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
+	static void SetNeatSpawnProperties(UObject* Object, const TMap<FName, FString>& Properties);
+
+	// Function used internally by Neat delegate functions for delegates listed in the "NeatCoalesce" metadata.
+	// Queues the dispatch, so that all fires during a frame result in a single execution of the Blueprint logic at the end of the frame.
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
+	static void QueueCoalescedDispatch(const FNeatCoalescedDispatch& Dispatch);
+
+	// Function used internally by Neat delegate functions with the "NeatPersistent" metadata, the first time an instance binds its delegates.
+	// UnbindFunction is looked up on FunctionClass, and called on Source (or the class default object, if static) once Owner is destroyed.
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true, DefaultToSelf = "Owner"))
+	static void RegisterNeatPersistentBinding(UObject* Owner, UObject* Source, UClass* FunctionClass, FName UnbindFunction);
+
+	// Number of persistent Neat delegate bindings whose owner is still alive.
+	UFUNCTION(BlueprintPure, Category = "Neat Functions")
+	static int32 GetNumActiveNeatPersistentBindings();
+
+	// Drops the cached results of all functions with the "NeatMemoize" metadata, e.g. after changing state they depend on within a frame.
+	UFUNCTION(BlueprintCallable, Category = "Neat Functions")
+	static void ClearNeatMemoizedResults();
+
+	// Functions with the "NeatMemoize" metadata always run while a bypass is open. Pure nodes are evaluated right before the node that reads them,
+	// so the ones read by nodes between these two calls aren't served from the cache. Bypasses still open at the end of the frame are closed.
+	UFUNCTION(BlueprintCallable, Category = "Neat Functions")
+	static void BeginNeatMemoizationBypass();
+
+	UFUNCTION(BlueprintCallable, Category = "Neat Functions")
+	static void EndNeatMemoizationBypass();
+
+	// Functions used internally by NeatBatchFunction nodes. A batch is started, given one array per batched parameter, and then executed,
+	// which calls the function once per element without going through the Blueprint VM for each of them.
+	// The node passes the handle returned by BeginNeatBatch to the other calls, so they can't end up on a batch that an aborted script left behind.
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
+	static int32 BeginNeatBatch(UClass* Class, FName FunctionName, bool bParallel);
+
+	UFUNCTION(BlueprintCallable, CustomThunk, meta = (BlueprintInternalUseOnly = true, CustomStructureParam = "Values"))
+	static void AddNeatBatchInput(int32 Batch, FName ParameterName, const int32& Values);
+	DECLARE_FUNCTION(execAddNeatBatchInput);
+
+	UFUNCTION(BlueprintCallable, CustomThunk, meta = (BlueprintInternalUseOnly = true, CustomStructureParam = "Values"))
+	static void AddNeatBatchOutput(int32 Batch, FName ParameterName, UPARAM(ref) int32& Values);
+	DECLARE_FUNCTION(execAddNeatBatchOutput);
+
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
+	static void ExecuteNeatBatch(int32 Batch);
+
+	// Functions inserted around Neat nodes when they are compiled with `NeatFunctions.InstrumentNodes` enabled.
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
+	static void NeatProfilerBeginSample(FGuid NodeGuid);
+
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
+	static void NeatProfilerEndSample(FGuid NodeGuid);
+
+	// Functions inserted into Neat nodes when they are compiled with `NeatFunctions.RecordNodes` enabled.
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
+	static void NeatRecordConstruction(FGuid NodeGuid, FName Function, UObject* Object);
+
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
+	static void NeatRecordDelegateFire(FGuid NodeGuid, FName Function, int32 PayloadSize);
 };
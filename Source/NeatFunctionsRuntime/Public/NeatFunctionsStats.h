@@ -0,0 +1,7 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#pragma once
+
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("NeatFunctions"), STATGROUP_NeatFunctions, STATCAT_Advanced);
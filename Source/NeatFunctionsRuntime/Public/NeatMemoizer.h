@@ -0,0 +1,98 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/IntegerSequence.h"
+#include "UObject/ObjectKey.h"
+
+/**
+ * Caches the results of pure native functions with the "NeatMemoize" metadata.
+ * The native thunk of each such function is replaced, but only calls made by Blueprint script are served from the cache.
+ * Calls through ProcessEvent, e.g. from native code, delegates or RPCs, always run the function, and so do script calls within a bypass.
+ * Inputs are hashed and compared through their properties, and results are served for `MemoizeScopeFrames` frames, or until Clear is called.
+ * Use `NeatFunctions.Memoize.Report` to print hit ratios and memory use.
+ */
+class NEATFUNCTIONSRUNTIME_API FNeatMemoizer
+{
+public:
+	static inline FLazyName MemoizeMetadataName { "NeatMemoize" };
+
+	// Each memoized function gets a thunk of its own, since pure static functions are called through EX_CallMath,
+	// which doesn't tell the thunk which function it was called for.
+	static constexpr int32 MaxMemoizedFunctions = 256;
+
+	static FNeatMemoizer& Get();
+
+	// Memoizes all functions with the metadata, or listed in the runtime settings.
+	void MemoizeTaggedFunctions();
+
+#if WITH_EDITOR
+	// Paths of the native functions with the metadata that end up in packaged builds, sorted.
+	static TArray<FString> FindTaggedFunctionPaths();
+#endif
+
+	bool Memoize(UFunction* Function);
+
+	// Returns false if the results of the function can't be cached, e.g. if one of its inputs can't be hashed.
+	static bool CanMemoize(const UFunction* Function, FString* OutReason = nullptr);
+
+	void Clear();
+	void Report(FOutputDevice& Ar) const;
+
+	// Calls made between BeginBypass and EndBypass always run the function. Bypasses still open at the end of the frame, e.g. because a script was aborted, are closed.
+	void BeginBypass();
+	void EndBypass();
+
+	uint64 GetNumHits() const;
+	uint64 GetNumMisses() const;
+	int64 GetMemoryBytes() const { return MemoryBytes; }
+
+private:
+	struct FEntry
+	{
+		uint32 Hash = 0;
+		FObjectKey Context;
+		uint64 Frame = 0;
+
+		// A full parameter struct, holding both the inputs and the results of the call.
+		uint8* Parms = nullptr;
+	};
+
+	struct FFunctionCache
+	{
+		UFunction* Function = nullptr;
+		FNativeFuncPtr OriginalFunc = nullptr;
+		TArray<FEntry> Entries;
+		int32 NextReplacedEntry = 0;
+		uint64 LastPurgeFrame = 0;
+		uint64 NumHits = 0;
+		uint64 NumMisses = 0;
+	};
+
+	template <int32 Slot>
+	static void execMemoized(UObject* Context, FFrame& Stack, RESULT_DECL);
+
+	template <int32... Slots>
+	static const FNativeFuncPtr* GetThunks(TIntegerSequence<int32, Slots...>);
+
+	void CallMemoized(FFunctionCache& Cache, UObject* Context, FFrame& Stack, RESULT_DECL);
+
+	static uint32 HashInputs(const UFunction* Function, const UObject* Context, const uint8* Parms);
+	static bool InputsMatch(const UFunction* Function, const uint8* A, const uint8* B);
+
+	void PurgeExpired(const UFunction* Function, FFunctionCache& Cache);
+	void AddEntry(const UFunction* Function, FFunctionCache& Cache, uint32 Hash, const UObject* Context, const uint8* Parms);
+	void FreeEntry(const UFunction* Function, FEntry& Entry);
+
+	// Indexed by the slot of the thunk each function was given.
+	TArray<FFunctionCache> Caches;
+
+	// Size of the cached parameter structs. Memory owned by containers in the parameters isn't included.
+	int64 MemoryBytes = 0;
+
+	int32 BypassDepth = 0;
+
+	FDelegateHandle PreGarbageCollectHandle;
+	FDelegateHandle EndFrameHandle;
+};
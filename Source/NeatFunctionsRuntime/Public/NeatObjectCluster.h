@@ -0,0 +1,65 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "NeatObjectCluster.generated.h"
+
+/**
+ * Root of a GC cluster holding the objects created by NeatConstructor nodes with the "NeatClustered" metadata.
+ * The garbage collector treats a cluster as a single object, so thousands of long-lived objects only cost a single reference to mark.
+ * Objects in a cluster are never collected individually. The whole cluster stays alive as long as anything references one of its objects.
+ */
+UCLASS(Transient)
+class NEATFUNCTIONSRUNTIME_API UNeatObjectCluster : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool CanBeClusterRoot() const override { return true; }
+
+	// Returns false if the object can't be part of a cluster, in which case it's only kept alive by the cluster.
+	bool Add(UObject* Object);
+
+	// Dissolves the cluster, after which the objects are collected like any other object once nothing references them.
+	void Release();
+
+	int32 Num() const { return Objects.Num(); }
+
+private:
+	UPROPERTY()
+	TArray<TObjectPtr<UObject>> Objects;
+};
+
+/**
+ * Tracks the UNeatObjectCluster of each owner, which is the outer of the clustered objects.
+ * Clusters aren't referenced from here, since that would keep their objects and, through them, the owner alive forever.
+ * Clusters of owners that have been destroyed are released before each garbage collection.
+ */
+class NEATFUNCTIONSRUNTIME_API FNeatObjectClusters
+{
+public:
+	static FNeatObjectClusters& Get();
+
+	void Add(UObject* Object);
+	void Release(const UObject* Owner);
+
+	UNeatObjectCluster* Find(const UObject* Owner) const;
+
+	int32 GetNumClusters() const { return Clusters.Num(); }
+
+private:
+	struct FEntry
+	{
+		TWeakObjectPtr<UNeatObjectCluster> Cluster;
+		int32 NumObjects = 0;
+	};
+
+	void ReleaseEntry(const FEntry& Entry);
+	void ReleaseStale();
+
+	TMap<TWeakObjectPtr<const UObject>, FEntry> Clusters;
+
+	FDelegateHandle PreGarbageCollectHandle;
+};
@@ -0,0 +1,51 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/WeakObjectPtr.h"
+
+/**
+ * Tracks the objects that have bound a Neat delegate function with the "NeatPersistent" metadata.
+ * The binding itself is only made once per instance by the compiled node. The metadata names a function on the same class that takes the owner,
+ * and removes every delegate bound to it. Once the owner is destroyed, that function is called on the object the delegates were bound on.
+ * This happens after actors have ticked and at the end of the frame, never during garbage collection, so the owner is always still reachable when it's passed on.
+ */
+class NEATFUNCTIONSRUNTIME_API FNeatPersistentBindings
+{
+public:
+	static FNeatPersistentBindings& Get();
+
+	// Source is the object the delegates were bound on, or null if the bind function is static.
+	void Register(const UObject* Owner, UObject* Source, const UClass* FunctionClass, FName UnbindFunction);
+
+	// Number of bindings whose owner is still alive.
+	int32 GetNumActive();
+
+private:
+	// Unbinds the bindings whose owner has been destroyed. Destroyed objects are marked as garbage, but stay reachable until the next garbage collection.
+	void UnbindDestroyedOwners();
+
+	// Drops the bindings whose owner was collected before it could be unbound, e.g. because it became unreachable without being destroyed.
+	// Their delegates stay behind on the source, but never fire again, since delegates bound to a collected object aren't executed.
+	void RemoveCollectedOwners();
+
+	void RemoveDelegates();
+
+	struct FBinding
+	{
+		TWeakObjectPtr<const UObject> Owner;
+		TWeakObjectPtr<UObject> Source;
+		TWeakObjectPtr<const UClass> FunctionClass;
+		FName UnbindFunction;
+	};
+
+	static void Unbind(const FBinding& Binding);
+
+	TArray<FBinding> Bindings;
+
+	FDelegateHandle PostActorTickHandle;
+	FDelegateHandle EndFrameHandle;
+	FDelegateHandle PostGarbageCollectHandle;
+	FDelegateHandle PreExitHandle;
+};
@@ -0,0 +1,79 @@
+﻿// Copyright Viktor Pramberg. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IFileHandle;
+
+enum class ENeatRecordType : uint8
+{
+	Construction,
+	DelegateFire,
+};
+
+/**
+ * A single Neat delegate fire or NeatConstructor spawn. Functions and classes are stored as indices into the name table of the capture.
+ */
+struct NEATFUNCTIONSRUNTIME_API FNeatRecord
+{
+	// Seconds since the capture was started.
+	double Timestamp = 0.0;
+	uint64 Frame = 0;
+	FGuid NodeGuid;
+	int32 FunctionIndex = INDEX_NONE;
+	int32 ClassIndex = INDEX_NONE;
+	uint32 PayloadSize = 0;
+	ENeatRecordType Type = ENeatRecordType::Construction;
+
+	// Every record takes up exactly this many bytes in a capture, which is what lets the capture be used as a ring buffer.
+	static constexpr int32 SerializedSize = 45;
+
+	friend FArchive& operator<<(FArchive& Ar, FNeatRecord& Record);
+};
+
+/**
+ * Streams Neat delegate fires and NeatConstructor spawns to a capture file, so the exact sequence of calls can be replayed offline with the NeatReplay commandlet.
+ * Only nodes compiled with `NeatFunctions.RecordNodes` enabled report to the recorder. Recording is started with `NeatFunctions.Record.Start`.
+ *
+ * The capture is a fixed number of record slots that are overwritten in a ring, so it can be left running and always holds the latest records.
+ * Names are written to a separate `.names` file that is only ever appended to. Both files are written at the end of each frame.
+ */
+class NEATFUNCTIONSRUNTIME_API FNeatRecorder
+{
+public:
+	static FNeatRecorder& Get();
+
+	bool Start(const FString& Filename, int32 Capacity);
+	void Stop();
+
+	bool IsRecording() const { return CaptureHandle.IsValid(); }
+
+	void RecordConstruction(const FGuid& NodeGuid, FName Function, const UClass* Class);
+	void RecordDelegateFire(const FGuid& NodeGuid, FName Function, int32 PayloadSize);
+
+	// Writes pending records and names to disk.
+	void Flush();
+
+	// Reads a capture, with the records ordered from oldest to newest.
+	static bool ReadCapture(const FString& Filename, TArray<FNeatRecord>& OutRecords, TArray<FString>& OutNames);
+
+	static FString GetNamesFilename(const FString& Filename);
+
+private:
+	int32 GetNameIndex(FName Name);
+	void WriteHeader();
+
+	TUniquePtr<IFileHandle> CaptureHandle;
+	TUniquePtr<IFileHandle> NamesHandle;
+
+	TArray<FNeatRecord> PendingRecords;
+	TMap<FName, int32> NameIndices;
+	TArray<FName> PendingNames;
+
+	int32 Capacity = 0;
+	uint64 NumWritten = 0;
+	double StartTime = 0.0;
+
+	FDelegateHandle EndFrameHandle;
+};